@@ -1831,7 +1831,7 @@ bash_default_completion (text, start, end, qc, compflags)
   /* If the word starts in `~', and there is no slash in the word, then
      try completing this word as a username. */
   if (matches == 0 && *text == '~' && mbschr (text, '/') == 0)
-    matches = rl_completion_matches (text, rl_username_completion_function);
+    matches = rl_completion_matches (text, bash_username_completion_function);
 
   /* Another one.  Why not?  If the word starts in '@', then look through
      the world of known hostnames for completion first. */
@@ -2639,6 +2639,7 @@ bash_servicename_completion_function (text, state)
 
 /*
  * A completion function for group names from /etc/group (or wherever).
+ * The names come from the shell's cache of the group database.
  */
 char *
 bash_groupname_completion_function (text, state)
@@ -2649,8 +2650,8 @@ bash_groupname_completion_function (text, state)
   return ((char *)NULL);
 #else
   static char *gname = (char *)NULL;
-  static struct group *grent;
-  static int gnamelen;
+  static char **glist;
+  static int gnamelen, gind;
   char *value;
 
   if (state == 0)
@@ -2659,23 +2660,70 @@ bash_groupname_completion_function (text, state)
       gname = savestring (text);
       gnamelen = strlen (gname);
 
-      setgrent ();
+      glist = sh_group_names ();
+      gind = 0;
     }
 
-  while (grent = getgrent ())
+  while (glist && (value = glist[gind]))
     {
-      if (gnamelen == 0 || (STREQN (gname, grent->gr_name, gnamelen)))
-        break;
+      gind++;
+      if (gnamelen == 0 || (STREQN (gname, value, gnamelen)))
+        return (savestring (value));
     }
 
-  if (grent == 0)
+  return ((char *)NULL);
+#endif
+}
+
+/*
+ * A completion function for user names, like rl_username_completion_function
+ * but using the shell's cache of the password database.
+ */
+char *
+bash_username_completion_function (text, state)
+     const char *text;
+     int state;
+{
+#if defined (__WIN32__) || defined (__OPENNT)
+  return ((char *)NULL);
+#else
+  static char *username = (char *)NULL;
+  static char **ulist;
+  static int namelen, first_char, first_char_loc, uind;
+  char *value, *name;
+
+  if (state == 0)
     {
-      endgrent ();
-      return ((char *)NULL);
+      FREE (username);
+
+      first_char = *text;
+      first_char_loc = first_char == '~';
+
+      username = savestring (&text[first_char_loc]);
+      namelen = strlen (username);
+
+      ulist = sh_user_names ();
+      uind = 0;
     }
 
-  value = savestring (grent->gr_name);
-  return (value);
+  while (ulist && (name = ulist[uind]))
+    {
+      uind++;
+      /* Null usernames should result in all users as possible completions. */
+      if (namelen == 0 || (STREQN (username, name, namelen)))
+	{
+	  value = (char *)xmalloc (2 + strlen (name));
+	  *value = *text;
+	  strcpy (value + first_char_loc, name);
+
+	  if (first_char == '~')
+	    rl_filename_completion_desired = 1;
+
+	  return (value);
+	}
+    }
+
+  return ((char *)NULL);
 #endif
 }
 
@@ -3756,7 +3804,7 @@ static int
 bash_complete_username_internal (what_to_do)
      int what_to_do;
 {
-  return bash_specific_completion (what_to_do, rl_username_completion_function);
+  return bash_specific_completion (what_to_do, bash_username_completion_function);
 }
 
 static int
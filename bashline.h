@@ -58,6 +58,7 @@ extern void set_directory_hook PARAMS((void));
 /* Used by programmable completion code. */
 extern char *command_word_completion_function PARAMS((const char *, int));
 extern char *bash_groupname_completion_function PARAMS((const char *, int));
+extern char *bash_username_completion_function PARAMS((const char *, int));
 extern char *bash_servicename_completion_function PARAMS((const char *, int));
 
 extern char **get_hostname_list PARAMS((void));
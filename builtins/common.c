@@ -414,6 +414,7 @@ remember_args (list, destructive)
       dispose_words (rest_of_args);
       rest_of_args = copy_word_list (list);
       posparam_count += list_length (list);
+      invalidate_posparam_index ();
     }
 
   if (destructive)
@@ -427,32 +428,49 @@ shift_args (times)
      int times;
 {
   WORD_LIST *temp;
-  int count;
+  int count, n, consumed;
 
   if (times <= 0)		/* caller should check */
     return;
 
-  while (times-- > 0)
-    {
-      if (dollar_vars[1])
-	free (dollar_vars[1]);
+  /* Shift everything at once instead of one position at a time: free the
+     parameters that fall off the front, move the survivors among the first
+     nine down, discard whatever else falls off the front of REST_OF_ARGS,
+     and refill DOLLAR_VARS from it. */
+  for (count = 1; count < 10 && count <= times; count++)
+    FREE (dollar_vars[count]);
+
+  for (count = 1; count + times < 10; count++)
+    dollar_vars[count] = dollar_vars[count + times];
 
-      for (count = 1; count < 9; count++)
-	dollar_vars[count] = dollar_vars[count + 1];
+  consumed = 0;
+  for (n = times - 9; n > 0 && rest_of_args; n--, consumed++)
+    {
+      temp = rest_of_args;
+      rest_of_args = rest_of_args->next;
+      temp->next = (WORD_LIST *)NULL;
+      dispose_words (temp);
+    }
 
+  for ( ; count < 10; count++)
+    {
       if (rest_of_args)
 	{
 	  temp = rest_of_args;
-	  dollar_vars[9] = savestring (temp->word->word);
+	  dollar_vars[count] = savestring (temp->word->word);
 	  rest_of_args = rest_of_args->next;
 	  temp->next = (WORD_LIST *)NULL;
 	  dispose_words (temp);
+	  consumed++;
 	}
       else
-	dollar_vars[9] = (char *)NULL;
-
-      posparam_count--;
+	dollar_vars[count] = (char *)NULL;
     }
+
+  posparam_count -= times;
+  if (posparam_count < 0)
+    posparam_count = 0;
+  shift_posparam_index (consumed);
 }
 
 int
@@ -212,6 +212,7 @@ extern WORD_LIST *get_directory_stack PARAMS((int));
 
 /* Functions from evalstring.c */
 extern int parse_and_execute PARAMS((char *, const char *, int));
+extern int execute_parsed_string PARAMS((char *, COMMAND *, const char *, int));
 extern int evalstring PARAMS((char *, const char *, int));
 extern void parse_and_execute_cleanup PARAMS((int));
 extern int parse_string PARAMS((char *, const char *, int, COMMAND **, char **));
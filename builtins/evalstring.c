@@ -63,6 +63,10 @@ extern int errno;
 
 int parse_and_execute_level = 0;
 
+/* Set by execute_parsed_string to the already-parsed form of the string
+   parse_and_execute is about to run. */
+static COMMAND *parsed_string_command = (COMMAND *)NULL;
+
 static int cat_file PARAMS((REDIRECT *));
 
 #define PE_TAG "parse_and_execute top"
@@ -299,7 +303,7 @@ parse_and_execute (string, from_file, flags)
      const char *from_file;
      int flags;
 {
-  int code, lreset;
+  int code, lreset, pr;
   volatile int should_jump_to_top_level, last_result;
   COMMAND *volatile command;
   volatile sigset_t pe_sigmask;
@@ -430,7 +434,18 @@ parse_and_execute (string, from_file, flags)
 	    }
 	}
 
-      if (parse_command () == 0)
+      if (parsed_string_command)
+	{
+	  /* The caller has already parsed all of STRING */
+	  global_command = parsed_string_command;
+	  parsed_string_command = (COMMAND *)NULL;
+	  bash_input.location.string += strlen (bash_input.location.string);
+	  pr = 0;
+	}
+      else
+	pr = parse_command ();
+
+      if (pr == 0)
 	{
 	  int local_expalias, local_alflag;
 
@@ -574,6 +589,13 @@ parse_and_execute (string, from_file, flags)
 
  out:
 
+  /* We broke out of the loop before running the caller's parsed command */
+  if (parsed_string_command)
+    {
+      dispose_command (parsed_string_command);
+      parsed_string_command = (COMMAND *)NULL;
+    }
+
   run_unwind_frame (PE_TAG);
 
   if (interrupt_state && parse_and_execute_level == 0)
@@ -593,6 +615,22 @@ parse_and_execute (string, from_file, flags)
   return (last_result);
 }
 
+/* Like parse_and_execute, but COMMAND is the result of parsing all of
+   STRING as a single command (e.g., with parse_string_to_command), so
+   STRING is not parsed again.  COMMAND is disposed when it has been
+   executed.  Used by command and process substitution to run cached parse
+   trees in the child. */
+int
+execute_parsed_string (string, command, from_file, flags)
+     char *string;
+     COMMAND *command;
+     const char *from_file;
+     int flags;
+{
+  parsed_string_command = command;
+  return (parse_and_execute (string, from_file, flags));
+}
+
 /* Parse a command contained in STRING according to FLAGS and return the
    number of characters consumed from the string.  If non-NULL, set *ENDP
    to the position in the string where the parse ended.  Used to validate
@@ -701,6 +739,10 @@ parse_string (string, from_file, flags, cmdp, endp)
 	    rewind_input_string ();
 	  break;
 	}
+
+      /* Stop after the first non-empty command */
+      if ((flags & SEVAL_ONECMD) && (cmdp == 0 || *cmdp))
+	break;
     }
 
 out:
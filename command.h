@@ -247,12 +247,25 @@ typedef struct pattern_list {
   int flags;
 } PATTERN_LIST;
 
+/* What's known about a case command's patterns before they're expanded.
+   Filled in the first time the command or any copy of it is executed, and
+   shared among the copies. */
+typedef struct case_dispatch {
+  int refcount;
+  int nclauses;			/* -1 until the patterns have been examined */
+  int *clause_start;		/* index of each clause's first pattern */
+  char **patterns;		/* glob patterns of words needing no expansion */
+  char **literals;		/* strings those patterns match, if only one */
+  struct hash_table *literal_clauses;	/* literal -> first clause with it */
+} CASE_DISPATCH;
+
 /* The CASE command. */
 typedef struct case_com {
   int flags;			/* See description of CMD flags. */
   int line;			/* line number the `case' keyword appears on */
   WORD_DESC *word;		/* The thing to test. */
   PATTERN_LIST *clauses;	/* The clauses to test against, or NULL. */
+  CASE_DISPATCH *dispatch;	/* Pattern information shared with copies. */
 } CASE_COM;
 
 /* FOR command. */
@@ -340,6 +353,12 @@ typedef struct simple_com {
   WORD_LIST *words;		/* The program name, the arguments,
 				   variable assignments, etc. */
   REDIRECT *redirects;		/* Redirections to perform. */
+  unsigned int lookup_gen;	/* command_lookup_generation at last lookup */
+  struct variable *lookup_func;	/* cached shell function lookup */
+  struct builtin *lookup_builtin; /* cached shell builtin lookup */
+  unsigned int words_gen;	/* command_lookup_generation when the words
+				   were last classified */
+  struct test_compiled *test_comp; /* precompiled test or [ expression */
 } SIMPLE_COM;
 
 /* The "function definition" command. */
@@ -178,6 +178,12 @@
    0 means the limit is not active. */
 #define SOURCENEST_MAX 0
 
+/* Define to the number of seconds the shell remembers home directories and
+   user and group names looked up in the password and group databases, for
+   tilde expansion and completion.  `hash -r' forgets them all; 0 means
+   don't remember them at all. */
+#define PWCACHE_TIMEOUT 300
+
 /* Define to use libc mktemp/mkstemp instead of replacements in lib/sh/tmpfile.c */
 #define USE_MKTEMP
 #define USE_MKSTEMP
@@ -257,6 +257,11 @@ copy_case_command (com)
   new_case->line = com->line;
   new_case->word = copy_word (com->word);
   new_case->clauses = copy_case_clauses (com->clauses);
+  /* The copied patterns are identical, so the copy can share what's been
+     learned about them. */
+  new_case->dispatch = com->dispatch;
+  if (new_case->dispatch)
+    new_case->dispatch->refcount++;
   return (new_case);
 }
 
@@ -333,6 +338,11 @@ copy_simple_command (com)
   new_simple->words = copy_word_list (com->words);
   new_simple->redirects = com->redirects ? copy_redirects (com->redirects) : (REDIRECT *)NULL;
   new_simple->line = com->line;
+  new_simple->lookup_gen = 0;
+  new_simple->lookup_func = (SHELL_VAR *)NULL;
+  new_simple->lookup_builtin = (struct builtin *)NULL;
+  new_simple->words_gen = 0;
+  new_simple->test_comp = (struct test_compiled *)NULL;
   return (new_simple);
 }
 
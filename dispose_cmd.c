@@ -31,6 +31,9 @@
 
 extern sh_obj_cache_t wdcache, wlcache;
 
+static void dispose_case_dispatch PARAMS((CASE_DISPATCH *));
+static void dispose_case_clause_index PARAMS((PTR_T));
+
 /* Dispose of the command structure passed. */
 void
 dispose_command (command)
@@ -116,6 +119,7 @@ dispose_command (command)
 	    p = p->next;
 	    free (t);
 	  }
+	dispose_case_dispatch (c->dispatch);
 	free (c);
 	break;
       }
@@ -151,6 +155,7 @@ dispose_command (command)
 	c = command->value.Simple;
 	dispose_words (c->words);
 	dispose_redirects (c->redirects);
+	FREE (c->test_comp);
 	free (c);
 	break;
       }
@@ -205,6 +210,44 @@ dispose_command (command)
   free (command);
 }
 
+/* The data in the literal_clauses table point into clause_start. */
+static void
+dispose_case_clause_index (data)
+     PTR_T data;
+{
+}
+
+/* Release one case command's reference to the information about its
+   patterns. */
+static void
+dispose_case_dispatch (d)
+     CASE_DISPATCH *d;
+{
+  int i, n;
+
+  if (d == 0 || --d->refcount > 0)
+    return;
+
+  if (d->nclauses > 0)
+    {
+      n = d->clause_start[d->nclauses];
+      for (i = 0; i < n; i++)
+	{
+	  FREE (d->patterns[i]);
+	  FREE (d->literals[i]);
+	}
+      free (d->clause_start);
+      free (d->patterns);
+      free (d->literals);
+    }
+  if (d->literal_clauses)
+    {
+      hash_flush (d->literal_clauses, dispose_case_clause_index);
+      hash_dispose (d->literal_clauses);
+    }
+  free (d);
+}
+
 #if defined (COND_COMMAND)
 /* How to free a node in a conditional command. */
 void
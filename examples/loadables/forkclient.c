@@ -0,0 +1,165 @@
+/* forkclient - ask a shell running the forkserver builtin to run a command */
+
+/*
+   Copyright (C) 2022 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash.
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* usage: forkclient socket command_string [name [args ...]]
+
+   A stand-alone program, not a loadable builtin: it takes the place of
+   `bash -c command_string [name [args ...]]', sending the request to the
+   shell listening on SOCKET and exiting with the command's status.  See
+   forkserver.c for the protocol. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+extern char **environ;
+
+static char *progname;
+
+static void
+fatal (msg, arg)
+     char *msg, *arg;
+{
+  fprintf (stderr, "%s: %s: %s\n", progname, arg, msg);
+  exit (126);
+}
+
+static char *
+addstr (buf, lenp, sizep, s)
+     char *buf;
+     size_t *lenp, *sizep;
+     char *s;
+{
+  size_t l;
+
+  l = strlen (s) + 1;
+  if (*lenp + l > *sizep)
+    {
+      while (*lenp + l > *sizep)
+	*sizep = *sizep ? *sizep * 2 : 4096;
+      buf = realloc (buf, *sizep);
+      if (buf == 0)
+	fatal ("out of memory", "realloc");
+    }
+  memcpy (buf + *lenp, s, l);
+  *lenp += l;
+  return buf;
+}
+
+int
+main (argc, argv)
+     int argc;
+     char **argv;
+{
+  struct sockaddr_un server;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE (3 * sizeof (int))];
+    struct cmsghdr align;
+  } cbuf;
+  int sock, fds[3], i, status;
+  char *buf, *cwd, nbuf[32];
+  size_t len, size, off;
+  uint32_t plen;
+  ssize_t n;
+
+  progname = argv[0];
+  if (argc < 3)
+    {
+      fprintf (stderr, "usage: %s socket command_string [name [args ...]]\n", progname);
+      exit (2);
+    }
+
+  memset ((char *)&server, 0, sizeof (server));
+  server.sun_family = AF_UNIX;
+  if (strlen (argv[1]) >= sizeof (server.sun_path))
+    fatal ("socket path too long", argv[1]);
+  strcpy (server.sun_path, argv[1]);
+
+  buf = NULL;
+  len = size = 0;
+
+  cwd = getcwd (NULL, 0);
+  buf = addstr (buf, &len, &size, cwd ? cwd : "/");
+  free (cwd);
+
+  snprintf (nbuf, sizeof (nbuf), "%d", argc - 2);
+  buf = addstr (buf, &len, &size, nbuf);
+  for (i = 2; i < argc; i++)
+    buf = addstr (buf, &len, &size, argv[i]);
+  for (i = 0; environ[i]; i++)
+    buf = addstr (buf, &len, &size, environ[i]);
+
+  if ((sock = socket (AF_UNIX, SOCK_STREAM, 0)) < 0)
+    fatal (strerror (errno), "socket");
+  if (connect (sock, (struct sockaddr *)&server, sizeof (server)) < 0)
+    fatal (strerror (errno), argv[1]);
+
+  for (i = 0; i < 3; i++)
+    fds[i] = i;
+
+  plen = len;
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = &plen;
+  iov.iov_len = sizeof (plen);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf.buf;
+  msg.msg_controllen = sizeof (cbuf.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (3 * sizeof (int));
+  memcpy (CMSG_DATA (cmsg), fds, 3 * sizeof (int));
+
+  if (sendmsg (sock, &msg, 0) != sizeof (plen))
+    fatal (strerror (errno), "sendmsg");
+
+  for (off = 0; off < len; off += n)
+    {
+      n = write (sock, buf + off, len - off);
+      if (n < 0 && errno == EINTR)
+	n = 0;
+      else if (n <= 0)
+	fatal (strerror (errno), "write");
+    }
+  free (buf);
+
+  /* The server closes the connection without a status if it can't run the
+     command */
+  for (off = 0; off < sizeof (status); off += n)
+    {
+      n = read (sock, (char *)&status + off, sizeof (status) - off);
+      if (n < 0 && errno == EINTR)
+	n = 0;
+      else if (n <= 0)
+	fatal ("no exit status from server", argv[1]);
+    }
+
+  exit (status);
+}
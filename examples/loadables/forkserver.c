@@ -0,0 +1,457 @@
+/* forkserver - run commands in children of an initialized shell on request */
+
+/*
+   Copyright (C) 2022 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash.
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* A job runner that starts many short `bash -c command' processes pays for
+   shell startup (locale initialization, importing the environment, reading
+   $BASH_ENV, sourcing function libraries) every time.  This builtin lets a
+   shell that has already done all that listen on a Unix domain socket and
+   run each requested command in a forked child, which starts out with all
+   of the server's functions and variables.  forkclient.c is the matching
+   client, invoked like `bash -c'.
+
+   The protocol is simple, since both ends are on the same machine:
+
+   The client sends a single message with its standard input, output, and
+   error attached as SCM_RIGHTS ancillary data, and an unsigned 32-bit
+   payload length in host byte order as the data.  The payload follows on
+   the stream: a sequence of NUL-terminated strings consisting of the
+   client's current working directory, the number of arguments in decimal,
+   the arguments (command string, then $0, then the positional parameters,
+   as with `bash -c'), and the client's environment, one NAME=VALUE string
+   each.
+
+   The server forks a child to handle the request, which forks again to run
+   the command, waits for it, and writes its exit status (an int, as $?
+   would report it) back to the client before exiting. */
+
+#include <config.h>
+
+#if defined (HAVE_UNISTD_H)
+#  include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bashtypes.h"
+#include <errno.h>
+#include <signal.h>
+#include "posixwait.h"
+#include "typemax.h"
+
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "loadables.h"
+#include "bashjmp.h"
+#include "jobs.h"
+#include "trap.h"
+#include "filecntl.h"
+
+#if !defined (errno)
+extern int errno;
+#endif
+
+/* Refuse absurd requests */
+#define FS_MAXPAYLOAD	(16 * 1024 * 1024)
+
+extern int last_command_exit_value;
+
+static int fs_recvfds PARAMS((int, int *, uint32_t *));
+static int fs_readall PARAMS((int, char *, size_t));
+static void fs_child PARAMS((int, int *, char *, uint32_t));
+static void fs_runcmd PARAMS((int *, char *, uint32_t)) __attribute__((__noreturn__));
+
+/* Receive the request header from FD: three file descriptors, stored into
+   FDS, and the payload length, stored into LENP.  Returns 0 on success. */
+static int
+fs_recvfds (fd, fds, lenp)
+     int fd;
+     int *fds;
+     uint32_t *lenp;
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE (3 * sizeof (int))];
+    struct cmsghdr align;
+  } cbuf;
+  ssize_t n;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = lenp;
+  iov.iov_len = sizeof (*lenp);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf.buf;
+  msg.msg_controllen = sizeof (cbuf.buf);
+
+  do
+    n = recvmsg (fd, &msg, 0);
+  while (n < 0 && errno == EINTR);
+  if (n != sizeof (*lenp))
+    return -1;
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  if (cmsg == 0 || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	cmsg->cmsg_len != CMSG_LEN (3 * sizeof (int)))
+    return -1;
+  memcpy (fds, CMSG_DATA (cmsg), 3 * sizeof (int));
+  return 0;
+}
+
+static int
+fs_readall (fd, buf, len)
+     int fd;
+     char *buf;
+     size_t len;
+{
+  ssize_t n;
+
+  while (len > 0)
+    {
+      n = read (fd, buf, len);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return -1;
+      buf += n;
+      len -= n;
+    }
+  return 0;
+}
+
+/* The grandchild: become the shell that runs the requested command.  FDS
+   are the client's standard input, output, and error; PAYLOAD (LEN bytes)
+   is the rest of the request.  Doesn't return. */
+static void
+fs_runcmd (fds, payload, len)
+     int *fds;
+     char *payload;
+     uint32_t len;
+{
+  char *s, *end, *cwd, *cmd, *eq;
+  intmax_t argc;
+  int i, code, r;
+  WORD_LIST *args;
+  SHELL_VAR *v;
+
+  for (i = 0; i < 3; i++)
+    {
+      if (fds[i] != i && dup2 (fds[i], i) < 0)
+	_exit (EX_NOEXEC);
+      if (fds[i] != i)
+	close (fds[i]);
+    }
+
+  /* We're a new shell, not a subshell of the server */
+  dollar_dollar_pid = getpid ();
+  interactive = interactive_shell = login_shell = 0;
+  subshell_environment = 0;
+  without_job_control ();
+
+  /* A new shell starts without traps.  Signals the server ignores stay
+     ignored, as they would be in a shell the server started. */
+  restore_original_signals ();
+  restore_default_signal (DEBUG_TRAP);
+  restore_default_signal (ERROR_TRAP);
+  restore_default_signal (RETURN_TRAP);
+  set_sigchld_handler ();
+
+  end = payload + len;
+  cwd = payload;
+  s = cwd + strlen (cwd) + 1;
+  if (s >= end || legal_number (s, &argc) == 0 || argc < 1)
+    _exit (EX_BADUSAGE);
+  s += strlen (s) + 1;
+
+  cmd = s;
+  s += strlen (s) + 1;
+  if (argc > 1 && s < end)
+    {
+      FREE (dollar_vars[0]);
+      dollar_vars[0] = savestring (s);
+      s += strlen (s) + 1;
+    }
+  for (i = 2, args = (WORD_LIST *)NULL; i < argc && s < end; i++)
+    {
+      args = make_word_list (make_word (s), args);
+      s += strlen (s) + 1;
+    }
+  args = REVERSE_LIST (args, WORD_LIST *);
+  remember_args (args, 1);
+  dispose_words (args);
+
+  /* Adopt the client's environment; variables exported by the server that
+     the client doesn't have stay as they are. */
+  for ( ; s < end; s += strlen (s) + 1)
+    {
+      eq = strchr (s, '=');
+      if (eq == 0)
+	continue;
+      *eq = '\0';
+      if (legal_identifier (s))
+	{
+	  v = find_variable (s);
+	  if (v == 0 || (readonly_p (v) == 0 && noassign_p (v) == 0))
+	    {
+	      v = bind_variable (s, eq + 1, 0);
+	      if (v)
+		{
+		  VSETATTR (v, att_exported);
+		  /* PATH, LANG, and so on take effect as if assigned */
+		  if (ifsname (s))
+		    setifs (v);
+		  else
+		    stupidly_hack_special_variables (s);
+		}
+	    }
+	}
+      *eq = '=';
+    }
+  array_needs_making = 1;
+
+  if (chdir (cwd) == 0)
+    {
+      set_working_directory (cwd);
+      bind_variable ("PWD", cwd, 0);
+    }
+  else
+    builtin_error ("%s: %s", cwd, strerror (errno));
+
+  /* Like run_one_command in shell.c */
+  code = setjmp_nosigs (top_level);
+  if (code == NOT_JUMPED)
+    r = parse_and_execute (savestring (cmd), "-c", SEVAL_NOHIST|SEVAL_RESETLINE);
+  else if (code == FORCE_EOF)
+    r = last_command_exit_value = 127;
+  else if (code == DISCARD)
+    r = last_command_exit_value = 1;
+  else
+    r = last_command_exit_value;
+
+  exit_shell (r);
+}
+
+/* The child the server forks for each connection on SOCK: read the rest of
+   the request, fork the process that runs the command, and send its exit
+   status back to the client. */
+static void
+fs_child (sock, fds, payload, len)
+     int sock;
+     int *fds;
+     char *payload;
+     uint32_t len;
+{
+  pid_t pid;
+  WAIT status;
+  int r;
+
+  /* We wait for the command ourselves */
+  signal (SIGCHLD, SIG_DFL);
+
+  pid = fork ();
+  if (pid < 0)
+    _exit (EX_NOEXEC);
+  if (pid == 0)
+    {
+      close (sock);
+      fs_runcmd (fds, payload, len);
+    }
+
+  for (r = 0; r < 3; r++)
+    close (fds[r]);
+
+  while (waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      _exit (EXECUTION_FAILURE);
+
+  if (WIFSIGNALED (status))
+    r = 128 + WTERMSIG (status);
+  else
+    r = WEXITSTATUS (status);
+
+  write (sock, &r, sizeof (r));
+  _exit (EXECUTION_SUCCESS);
+}
+
+int
+forkserver_builtin (list)
+     WORD_LIST *list;
+{
+  int opt, servsock, sock, fds[3], i;
+  intmax_t nconn, nserved;
+  char *path, *payload;
+  uint32_t len;
+  struct sockaddr_un server;
+  mode_t omask;
+  pid_t pid;
+
+  nconn = -1;
+  reset_internal_getopt ();
+  while ((opt = internal_getopt (list, "n:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  if (legal_number (list_optarg, &nconn) == 0 || nconn < 0)
+	    {
+	      sh_invalidnum (list_optarg);
+	      return (EXECUTION_FAILURE);
+	    }
+	  break;
+	CASE_HELPOPT;
+	default:
+	  builtin_usage ();
+	  return (EX_USAGE);
+	}
+    }
+  list = loptend;
+
+  if (list == 0)
+    {
+      builtin_usage ();
+      return (EX_USAGE);
+    }
+  path = list->word->word;
+
+  memset ((char *)&server, 0, sizeof (server));
+  server.sun_family = AF_UNIX;
+  if (strlen (path) >= sizeof (server.sun_path))
+    {
+      builtin_error ("%s: socket path too long", path);
+      return (EXECUTION_FAILURE);
+    }
+  strcpy (server.sun_path, path);
+
+  if ((servsock = socket (AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+      builtin_error ("cannot create socket: %s", strerror (errno));
+      return (EXECUTION_FAILURE);
+    }
+  SET_CLOSE_ON_EXEC (servsock);
+
+  /* Only the owner may connect and run commands */
+  omask = umask (077);
+  i = bind (servsock, (struct sockaddr *)&server, sizeof (server));
+  umask (omask);
+  if (i < 0)
+    {
+      builtin_error ("%s: socket bind failure: %s", path, strerror (errno));
+      close (servsock);
+      return (EXECUTION_FAILURE);
+    }
+
+  if (listen (servsock, 64) < 0)
+    {
+      builtin_error ("listen failure: %s", strerror (errno));
+      close (servsock);
+      unlink (path);
+      return (EXECUTION_FAILURE);
+    }
+
+  for (nserved = 0; nconn < 0 || nserved < nconn; )
+    {
+      sock = accept (servsock, (struct sockaddr *)NULL, (socklen_t *)NULL);
+      if (sock < 0)
+	{
+	  if (errno == EINTR)
+	    {
+	      if (terminating_signal || interrupt_state)
+		break;
+	      continue;
+	    }
+	  builtin_error ("accept failure: %s", strerror (errno));
+	  break;
+	}
+
+      payload = (char *)NULL;
+      if (fs_recvfds (sock, fds, &len) < 0)
+	{
+	  close (sock);
+	  continue;
+	}
+      if (len == 0 || len > FS_MAXPAYLOAD || (payload = xmalloc (len + 1)) == 0 ||
+	  fs_readall (sock, payload, len) < 0)
+	{
+	  FREE (payload);
+	  for (i = 0; i < 3; i++)
+	    close (fds[i]);
+	  close (sock);
+	  continue;
+	}
+      payload[len] = '\0';	/* make sure the last string is terminated */
+
+      pid = fork ();
+      if (pid == 0)
+	{
+	  close (servsock);
+	  fs_child (sock, fds, payload, len);
+	}
+      else if (pid < 0)
+	builtin_error ("fork failure: %s", strerror (errno));
+
+      /* The shell's SIGCHLD handler reaps the child */
+      free (payload);
+      for (i = 0; i < 3; i++)
+	close (fds[i]);
+      close (sock);
+      nserved++;
+
+      QUIT;
+    }
+
+  close (servsock);
+  unlink (path);
+
+  QUIT;
+  return (EXECUTION_SUCCESS);
+}
+
+char *forkserver_doc[] = {
+	"Run commands from clients in children of this shell.",
+	"",
+	"Listen for connections on the Unix domain socket PATH and run each",
+	"command a client sends in a child of the shell that inherits the",
+	"shell's functions and variables, as if run by `bash -c'.  The",
+	"child uses the client's standard input, output, and error, current",
+	"directory, arguments, and environment, and the client receives",
+	"its exit status.  The matching client is `forkclient'.",
+	"",
+	"The socket is accessible only by the user running the shell.",
+	"",
+	"Options:",
+	"    -n count    exit after handling COUNT connections",
+	"",
+	"Exit Status:",
+	"Returns success unless the socket cannot be created or an invalid",
+	"option is given.",
+	(char *) NULL
+};
+
+struct builtin forkserver_struct = {
+	"forkserver",		/* builtin name */
+	forkserver_builtin,	/* function implementing the builtin */
+	BUILTIN_ENABLED,	/* initial flags for builtin */
+	forkserver_doc,		/* array of long documentation strings. */
+	"forkserver [-n count] path",	/* usage synopsis; becomes short_doc */
+	0			/* reserved for internal use */
+};
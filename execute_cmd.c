@@ -78,9 +78,7 @@ extern int errno;
 #include "pathexp.h"
 #include "hashcmd.h"
 
-#if defined (COND_COMMAND)
-#  include "test.h"
-#endif
+#include "test.h"
 
 #include "builtins/common.h"
 #include "builtins/builtext.h"	/* list of builtins */
@@ -131,6 +129,7 @@ static int restore_signal_mask PARAMS((sigset_t *));
 
 static int builtin_status PARAMS((int));
 
+static WORD_LIST *next_for_word PARAMS((WORD_LIST *, WORD_LIST *));
 static int execute_for_command PARAMS((FOR_COM *));
 #if defined (SELECT_COMMAND)
 static int displen PARAMS((const char *));
@@ -158,6 +157,10 @@ static int time_command PARAMS((COMMAND *, int, int, int, struct fd_bitmap *));
 static intmax_t eval_arith_for_expr PARAMS((WORD_LIST *, int *));
 static int execute_arith_for_command PARAMS((ARITH_FOR_COM *));
 #endif
+static char *case_pattern PARAMS((WORD_DESC *));
+static int case_word_constant PARAMS((char *));
+static char *case_pattern_literal PARAMS((char *));
+static void analyze_case_patterns PARAMS((CASE_COM *));
 static int execute_case_command PARAMS((CASE_COM *));
 static int execute_while_command PARAMS((WHILE_COM *));
 static int execute_until_command PARAMS((WHILE_COM *));
@@ -166,6 +169,8 @@ static int execute_if_command PARAMS((IF_COM *));
 static int execute_null_command PARAMS((REDIRECT *, int, int, int));
 static void fix_assignment_words PARAMS((WORD_LIST *));
 static void fix_arrayref_words PARAMS((WORD_LIST *));
+static void compile_test_command PARAMS((SIMPLE_COM *));
+static void lookup_command_name PARAMS((SIMPLE_COM *, char *, SHELL_VAR **, struct builtin **));
 static int execute_simple_command PARAMS((SIMPLE_COM *, int, int, int, struct fd_bitmap *));
 static int execute_builtin PARAMS((sh_builtin_func_t *, WORD_LIST *, int, int));
 static int execute_function PARAMS((SHELL_VAR *, WORD_LIST *, int, struct fd_bitmap *, int, int));
@@ -304,6 +309,11 @@ int funcnest_max = 0;
 int evalnest = 0;
 int evalnest_max = EVALNEST_MAX;
 
+/* Incremented when the set of shell functions or builtins changes; a
+   simple command's cached lookup is valid only if it was made during the
+   current generation. */
+unsigned int command_lookup_generation = 1;
+
 int sourcenest = 0;
 int sourcenest_max = SOURCENEST_MAX;
 
@@ -2866,6 +2876,26 @@ execute_connection (command, asynchronous, pipe_in, pipe_out, fds_to_close)
     } \
   while (0)
 
+/* Return the word following LIST in the expanded word list of a for command,
+   whose first element is RELEASER.  LIST has been used, so free it now
+   instead of keeping the whole list until the loop finishes; the first
+   element stays, since it's what the unwind-protect frees. */
+static WORD_LIST *
+next_for_word (releaser, list)
+     WORD_LIST *releaser, *list;
+{
+  WORD_LIST *next;
+
+  next = list->next;
+  if (list != releaser)
+    {
+      releaser->next = next;
+      list->next = (WORD_LIST *)NULL;
+      dispose_words (list);
+    }
+  return (next);
+}
+
 /* Execute a FOR command.  The syntax is: FOR word_desc IN word_list;
    DO command; DONE */
 static int
@@ -2874,7 +2904,7 @@ execute_for_command (for_command)
 {
   register WORD_LIST *releaser, *list;
   SHELL_VAR *v;
-  char *identifier;
+  char *identifier, *for_head;
   int retval, save_line_number;
 #if 0
   SHELL_VAR *old_value = (SHELL_VAR *)NULL; /* Remember the old value of x. */
@@ -2900,6 +2930,17 @@ execute_for_command (for_command)
   begin_unwind_frame ("for");
   add_unwind_protect (dispose_words, releaser);
 
+  /* Remember what this command looks like, for the debugger.  It looks the
+     same every time through the loop, so print it once. */
+  for_head = (char *)NULL;
+  if (list)
+    {
+      command_string_index = 0;
+      print_for_command_head (for_command);
+      for_head = savestring (the_printed_command);
+      add_unwind_protect (xfree, for_head);
+    }
+
 #if 0
   if (lexical_scoping)
     {
@@ -2912,16 +2953,12 @@ execute_for_command (for_command)
   if (for_command->flags & CMD_IGNORE_RETURN)
     for_command->action->flags |= CMD_IGNORE_RETURN;
 
-  for (retval = EXECUTION_SUCCESS; list; list = list->next)
+  for (retval = EXECUTION_SUCCESS; list; list = next_for_word (releaser, list))
     {
       QUIT;
 
       line_number = for_command->line;
 
-      /* Remember what this command looks like, for debugger. */
-      command_string_index = 0;
-      print_for_command_head (for_command);
-
       if (echo_command_at_execute)
 	xtrace_print_for_command_head (for_command);
 
@@ -2930,7 +2967,7 @@ execute_for_command (for_command)
       if (signal_in_progress (DEBUG_TRAP) == 0 && running_trap == 0)
 	{
 	  FREE (the_printed_command_except_trap);
-	  the_printed_command_except_trap = savestring (the_printed_command);
+	  the_printed_command_except_trap = savestring (for_head);
 	}
 
       retval = run_debug_trap ();
@@ -2956,6 +2993,10 @@ execute_for_command (for_command)
 	  else
 	    v = bind_variable_value (v, list->word->word, ASS_NAMEREF);
 	}
+      /* Give the word to the variable we just looked up, if possible, instead
+	 of copying it and looking the variable up again. */
+      else if (v && (v = bind_variable_direct (v, list->word->word)))
+	list->word->word = (char *)NULL;
       else
 	v = bind_variable (identifier, list->word->word, 0);
 
@@ -2969,6 +3010,7 @@ execute_for_command (for_command)
 	    }
 	  else
 	    {
+	      FREE (for_head);
 	      dispose_words (releaser);
 	      discard_unwind_frame ("for");
 	      loop_level--;
@@ -3018,6 +3060,7 @@ execute_for_command (for_command)
     }
 #endif
 
+  FREE (for_head);
   dispose_words (releaser);
   discard_unwind_frame ("for");
   return (retval);
@@ -3527,6 +3570,171 @@ execute_select_command (select_command)
 }
 #endif /* SELECT_COMMAND */
 
+/* Expand the case command pattern W and return the result as a pattern
+   suitable for strmatch. */
+static char *
+case_pattern (w)
+     WORD_DESC *w;
+{
+  WORD_LIST *es;
+  char *pattern;
+  int qflags;
+
+  es = expand_word_leave_quoted (w, 0);
+
+  if (es && es->word && es->word->word && *(es->word->word))
+    {
+      /* Convert quoted null strings into empty strings. */
+      qflags = QGLOB_CVTNULL;
+
+      /* We left CTLESC in place quoting CTLESC and CTLNUL after the
+	 call to expand_word_leave_quoted; tell quote_string_for_globbing
+	 to remove those here. This works for both unquoted portions of
+	 the word (which call quote_escapes) and quoted portions
+	 (which call quote_string). */
+      qflags |= QGLOB_CTLESC;
+      pattern = quote_string_for_globbing (es->word->word, qflags);
+    }
+  else
+    {
+      pattern = (char *)xmalloc (1);
+      pattern[0] = '\0';
+    }
+
+  dispose_words (es);
+  return (pattern);
+}
+
+/* Return 1 if the unexpanded case pattern STRING undergoes nothing but quote
+   removal when it's expanded, so it expands the same way every time. */
+static int
+case_word_constant (string)
+     char *string;
+{
+  char *s;
+  int dquote;
+
+  for (s = string, dquote = 0; *s; s++)
+    switch (*s)
+      {
+      case '$':
+      case '`':
+      case CTLESC:
+      case CTLNUL:
+	return 0;
+      case '~':
+      case '<':
+      case '>':
+	if (dquote == 0)
+	  return 0;
+	break;
+      case '\\':
+	if (s[1] == 0)
+	  return 0;
+	s++;
+	break;
+      case '"':
+	dquote = 1 - dquote;
+	break;
+      case '\'':
+	if (dquote)
+	  break;
+	s = strchr (s + 1, '\'');
+	if (s == 0)
+	  return 0;
+	break;
+      }
+  return 1;
+}
+
+/* If the glob pattern PATTERN matches only a single string, return a newly-
+   allocated copy of that string; otherwise return NULL. */
+static char *
+case_pattern_literal (pattern)
+     char *pattern;
+{
+  char *ret, *r, *s;
+
+  ret = r = (char *)xmalloc (strlen (pattern) + 1);
+  for (s = pattern; *s; s++)
+    {
+      if (*s == '\\')
+	{
+	  if (*++s == 0)
+	    break;
+	}
+      else if (*s == '*' || *s == '?' || *s == '[' ||
+		((*s == '+' || *s == '@' || *s == '!') && s[1] == '('))
+	break;
+      *r++ = *s;
+    }
+  if (*s)
+    {
+      free (ret);
+      return ((char *)NULL);
+    }
+  *r = '\0';
+  return ret;
+}
+
+/* Fill in CASE_COMMAND's dispatch information: the patterns of any pattern
+   words that expand to the same thing every time, the strings those patterns
+   match if they contain no special pattern characters, and, if there are
+   enough of those, a hash table mapping each string to the first clause
+   containing it. */
+#define CASE_HASH_MIN	8
+#define CASE_HASH_BUCKETS	32	/* must be power of two */
+
+static void
+analyze_case_patterns (case_command)
+     CASE_COM *case_command;
+{
+  CASE_DISPATCH *d;
+  PATTERN_LIST *clauses;
+  WORD_LIST *list;
+  BUCKET_CONTENTS *item;
+  int c, i, n, nliterals;
+
+  d = case_command->dispatch;
+  for (n = c = 0, clauses = case_command->clauses; clauses; clauses = clauses->next, c++)
+    n += list_length (clauses->patterns);
+  d->nclauses = c;
+  if (c == 0)
+    return;
+
+  d->clause_start = (int *)xmalloc ((c + 1) * sizeof (int));
+  d->patterns = strvec_create (n);
+  d->literals = strvec_create (n);
+
+  nliterals = 0;
+  for (i = c = 0, clauses = case_command->clauses; clauses; clauses = clauses->next, c++)
+    {
+      d->clause_start[c] = i;
+      for (list = clauses->patterns; list; list = list->next, i++)
+	{
+	  d->patterns[i] = d->literals[i] = (char *)NULL;
+	  if ((list->word->flags & W_HASDOLLAR) || case_word_constant (list->word->word) == 0)
+	    continue;
+	  d->patterns[i] = case_pattern (list->word);
+	  if (d->literals[i] = case_pattern_literal (d->patterns[i]))
+	    nliterals++;
+	}
+    }
+  d->clause_start[c] = i;
+
+  if (nliterals < CASE_HASH_MIN)
+    return;
+
+  d->literal_clauses = hash_create (CASE_HASH_BUCKETS);
+  for (c = 0; c < d->nclauses; c++)
+    for (i = d->clause_start[c]; i < d->clause_start[c + 1]; i++)
+      if (d->literals[i] && hash_search (d->literals[i], d->literal_clauses, 0) == 0)
+	{
+	  item = hash_insert (savestring (d->literals[i]), d->literal_clauses, HASH_NOSRCH);
+	  item->data = (PTR_T)(d->clause_start + c);
+	}
+}
+
 /* Execute a CASE command.  The syntax is: CASE word_desc IN pattern_list ESAC.
    The pattern_list is a linked list of pattern clauses; each clause contains
    some patterns to compare word_desc against, and an associated command to
@@ -3536,10 +3744,13 @@ execute_case_command (case_command)
      CASE_COM *case_command;
 {
   register WORD_LIST *list;
-  WORD_LIST *wlist, *es;
+  WORD_LIST *wlist;
   PATTERN_LIST *clauses;
+  CASE_DISPATCH *d;
+  BUCKET_CONTENTS *item;
   char *word, *pattern;
-  int retval, match, ignore_return, save_line_number, qflags;
+  int retval, match, ignore_return, save_line_number;
+  int c, i, literal_clause;
 
   save_line_number = line_number;
   line_number = case_command->line;
@@ -3593,42 +3804,43 @@ execute_case_command (case_command)
   begin_unwind_frame ("case");
   add_unwind_protect (xfree, word);
 
+  /* Patterns that expand to the same thing every time are only expanded
+     once.  If there are enough patterns without special pattern characters,
+     find the first clause containing one equal to WORD, so the clauses
+     before it don't need to compare their literal patterns at all. */
+  d = case_command->dispatch;
+  if (d && d->nclauses < 0)
+    analyze_case_patterns (case_command);
+
+  literal_clause = 0;
+  if (d && d->literal_clauses && match_ignore_case == 0)
+    {
+      item = hash_search (word, d->literal_clauses, 0);
+      literal_clause = item ? (int *)item->data - d->clause_start : d->nclauses;
+    }
+
 #define EXIT_CASE()  goto exit_case_command
 
-  for (clauses = case_command->clauses; clauses; clauses = clauses->next)
+  for (c = 0, clauses = case_command->clauses; clauses; clauses = clauses->next, c++)
     {
       QUIT;
-      for (list = clauses->patterns; list; list = list->next)
+      for (i = d ? d->clause_start[c] : 0, list = clauses->patterns; list; list = list->next, i++)
 	{
-	  es = expand_word_leave_quoted (list->word, 0);
-
-	  if (es && es->word && es->word->word && *(es->word->word))
-	    {
-	      /* Convert quoted null strings into empty strings. */
-	      qflags = QGLOB_CVTNULL;
-
-	      /* We left CTLESC in place quoting CTLESC and CTLNUL after the
-	      	 call to expand_word_leave_quoted; tell quote_string_for_globbing
-	      	 to remove those here. This works for both unquoted portions of
-		 the word (which call quote_escapes) and quoted portions
-		 (which call quote_string). */
-	      qflags |= QGLOB_CTLESC;
-	      pattern = quote_string_for_globbing (es->word->word, qflags);
-	    }
+	  if (d && d->literals[i] && match_ignore_case == 0)
+	    match = c >= literal_clause && STREQ (d->literals[i], word);
 	  else
 	    {
-	      pattern = (char *)xmalloc (1);
-	      pattern[0] = '\0';
-	    }
+	      pattern = (d && d->patterns[i]) ? d->patterns[i] : case_pattern (list->word);
 
-	  /* Since the pattern does not undergo quote removal (as per
-	     Posix.2, section 3.9.4.3), the strmatch () call must be able
-	     to recognize backslashes as escape characters. */
-	  match = strmatch (pattern, word, FNMATCH_EXTFLAG|FNMATCH_IGNCASE) != FNM_NOMATCH;
-	  free (pattern);
+	      /* Since the pattern does not undergo quote removal (as per
+		 Posix.2, section 3.9.4.3), the strmatch () call must be able
+		 to recognize backslashes as escape characters. */
+	      match = strmatch (pattern, word, FNMATCH_EXTFLAG|FNMATCH_IGNCASE) != FNM_NOMATCH;
+	      if (d == 0 || pattern != d->patterns[i])
+		free (pattern);
 
-	  dispose_words (es);
-	  QUIT;
+	      QUIT;
+	    }
 
 	  if (match)
 	    {
@@ -3638,7 +3850,7 @@ execute_case_command (case_command)
 		    clauses->action->flags |= CMD_IGNORE_RETURN;
 		  retval = execute_command (clauses->action);
 		}
-	      while ((clauses->flags & CASEPAT_FALLTHROUGH) && (clauses = clauses->next));
+	      while ((clauses->flags & CASEPAT_FALLTHROUGH) && (c++, clauses = clauses->next));
 	      if (clauses == 0 || (clauses->flags & CASEPAT_TESTNEXT) == 0)
 		EXIT_CASE ();
 	      else
@@ -4064,7 +4276,9 @@ execute_cond_command (cond_command)
   debug_print_cond_command (cond_command);
 #endif
 
+  test_statcache_begin ();
   last_command_exit_value = retval = execute_cond_node (cond_command);
+  test_statcache_end ();
   line_number = save_line_number;
   return (retval);
 }
@@ -4290,6 +4504,29 @@ fix_arrayref_words (words)
 }
 #endif
 
+/* If SIMPLE_COMMAND runs the test or [ builtin, precompile its expression
+   if its form is fixed by the unexpanded words. */
+static void
+compile_test_command (simple_command)
+     SIMPLE_COM *simple_command;
+{
+  WORD_LIST *w;
+  struct builtin *b;
+
+  FREE (simple_command->test_comp);
+  simple_command->test_comp = (TEST_COMPILED *)NULL;
+
+  for (w = simple_command->words; w && (w->word->flags & W_ASSIGNMENT); w = w->next)
+    ;
+  if (w == 0 || (w->word->flags & (W_HASDOLLAR|W_QUOTED)) ||
+      (STREQ (w->word->word, "test") == 0 && STREQ (w->word->word, "[") == 0))
+    return;
+
+  b = builtin_address_internal (w->word->word, 0);
+  if (b && b->function == test_builtin)
+    simple_command->test_comp = test_compile (w->next, w->word->word[0] == '[');
+}
+
 #ifndef ISOPTION
 #  define ISOPTION(s, c)  (s[0] == '-' && s[1] == c && s[2] == 0)
 #endif
@@ -4351,6 +4588,43 @@ is_dirname (pathname)
   return ret;
 }
 
+/* Look up NAME, the expanded command name of SIMPLE_COMMAND, as a shell
+   function and as an enabled shell builtin, returning the results in FUNCP
+   and BUILTINP.  If NAME is the same as the unexpanded command word, the
+   results are cached in SIMPLE_COMMAND and reused until a function or
+   builtin is added, removed, enabled, or disabled. */
+static void
+lookup_command_name (simple_command, name, funcp, builtinp)
+     SIMPLE_COM *simple_command;
+     char *name;
+     SHELL_VAR **funcp;
+     struct builtin **builtinp;
+{
+  WORD_LIST *w;
+  int cacheable;
+
+  for (w = simple_command->words; w && (w->word->flags & W_ASSIGNMENT); w = w->next)
+    ;
+  cacheable = w && STREQ (w->word->word, name);
+
+  if (cacheable && simple_command->lookup_gen == command_lookup_generation)
+    {
+      *funcp = simple_command->lookup_func;
+      *builtinp = simple_command->lookup_builtin;
+      return;
+    }
+
+  *funcp = find_function (name);
+  *builtinp = builtin_address_internal (name, 0);
+
+  if (cacheable)
+    {
+      simple_command->lookup_gen = command_lookup_generation;
+      simple_command->lookup_func = *funcp;
+      simple_command->lookup_builtin = *builtinp;
+    }
+}
+
 /* The meaty part of all the executions.  We have to start hacking the
    real execution of commands here.  Fork a process, set things up,
    execute the command. */
@@ -4366,6 +4640,7 @@ execute_simple_command (simple_command, pipe_in, pipe_out, async, fds_to_close)
   int fork_flags, cmdflags;
   pid_t old_last_async_pid;
   sh_builtin_func_t *builtin;
+  struct builtin *cmdbuiltin;
   SHELL_VAR *func;
   volatile int old_builtin, old_command_builtin;
 
@@ -4437,8 +4712,9 @@ execute_simple_command (simple_command, pipe_in, pipe_out, async, fds_to_close)
       char *p;
 
       /* Do this now, because execute_disk_command will do it anyway in the
-	 vast majority of cases. */
-      maybe_make_export_env ();
+	 vast majority of cases.  The child adds any temporary environment
+	 to its own copy. */
+      maybe_make_base_export_env ();
 
       /* Don't let a DEBUG trap overwrite the command string to be saved with
 	 the process/job associated with this child. */
@@ -4500,9 +4776,17 @@ execute_simple_command (simple_command, pipe_in, pipe_out, async, fds_to_close)
     {
       current_fds_to_close = fds_to_close;
       fix_assignment_words (simple_command->words);
+      /* The array reference flags and precompiled test expression these
+	 set depend only on the unexpanded words and the builtin they name,
+	 so we only have to do it again if the builtins have changed. */
+      if (simple_command->words_gen != command_lookup_generation)
+	{
 #if defined (ARRAY_VARS)
-      fix_arrayref_words (simple_command->words);
+	  fix_arrayref_words (simple_command->words);
 #endif
+	  compile_test_command (simple_command);
+	  simple_command->words_gen = command_lookup_generation;
+	}
       /* Pass the ignore return flag down to command substitutions */
       if (cmdflags & CMD_IGNORE_RETURN)	/* XXX */
 	comsub_ignore_return++;
@@ -4541,12 +4825,15 @@ execute_simple_command (simple_command, pipe_in, pipe_out, async, fds_to_close)
     xtrace_print_word_list (words, 1);
 
   builtin = (sh_builtin_func_t *)NULL;
-  func = (SHELL_VAR *)NULL;
+
+  lookup_command_name (simple_command, words->word->word, &func, &cmdbuiltin);
 
   /* This test is still here in case we want to change the command builtin
      handler code below to recursively call execute_simple_command (after
      modifying the simple_command struct). */
-  if ((cmdflags & CMD_NO_FUNCTIONS) == 0)
+  if (cmdflags & CMD_NO_FUNCTIONS)
+    func = (SHELL_VAR *)NULL;
+  else
     {
       /* Posix.2 says special builtins are found before functions.  We
 	 don't set builtin_is_special anywhere other than here, because
@@ -4554,14 +4841,13 @@ execute_simple_command (simple_command, pipe_in, pipe_out, async, fds_to_close)
 	 being used, and we don't want to exit the shell if a special
 	 builtin executed with `command builtin' fails.  `command' is not
 	 a special builtin. */
-      if (posixly_correct)
+      if (posixly_correct && cmdbuiltin && (cmdbuiltin->flags & SPECIAL_BUILTIN))
 	{
-	  builtin = find_special_builtin (words->word->word);
-	  if (builtin)
-	    builtin_is_special = 1;
+	  current_builtin = cmdbuiltin;
+	  builtin = cmdbuiltin->function;
+	  builtin_is_special = 1;
+	  func = (SHELL_VAR *)NULL;
 	}
-      if (builtin == 0)
-	func = find_function (words->word->word);
     }
 
   /* What happens in posix mode when an assignment preceding a command name
@@ -4596,7 +4882,8 @@ itrace("execute_simple_command: posix mode tempenv assignment error");
       WORD_LIST *disposer, *l;
       int cmdtype;
 
-      builtin = find_shell_builtin (words->word->word);
+      current_builtin = cmdbuiltin;
+      builtin = cmdbuiltin ? cmdbuiltin->function : (sh_builtin_func_t *)NULL;
       while (builtin == command_builtin)
 	{
 	  disposer = words;
@@ -4622,7 +4909,7 @@ itrace("execute_simple_command: posix mode tempenv assignment error");
 	  unwind_protect_int (executing_command_builtin);
 	  executing_command_builtin |= 1;
 	}        
-      builtin = 0;
+      /* BUILTIN and current_builtin are left set for the code below */
     }
 
   add_unwind_protect (dispose_words, words);
@@ -4698,6 +4985,9 @@ run_builtin:
 
   if (builtin || func)
     {
+      /* test_command checks that the expanded words still match */
+      if (builtin == test_builtin && simple_command->test_comp)
+	test_compiled = *simple_command->test_comp;
       if (builtin)
         {
 	  old_builtin = executing_builtin;
@@ -5011,8 +5301,8 @@ maybe_restore_getopt_state (gs)
 }
 
 #if defined (ARRAY_VARS)
-void
-restore_funcarray_state (fa)
+static void
+pop_funcarray_state (fa)
      struct func_array_state *fa;
 {
   SHELL_VAR *nfv;
@@ -5024,11 +5314,67 @@ restore_funcarray_state (fa)
   GET_ARRAY_FROM_VAR ("FUNCNAME", nfv, funcname_a);
   if (nfv == fa->funcname_v)
     array_pop (funcname_a);
+}
 
+void
+restore_funcarray_state (fa)
+     struct func_array_state *fa;
+{
+  pop_funcarray_state (fa);
   free (fa);
 }
 #endif
 
+/* The state execute_function saves before calling a shell function and
+   restores when it returns.  Keeping it all in one place means a function
+   call registers one unwind-protect instead of a dozen, each of which
+   would allocate its own copy of what it saves. */
+struct func_call_state
+  {
+    sh_getopt_state_t *gs;
+    COMMAND *tc;
+    SHELL_VAR *this_shell_function;
+    int line_number;
+    int line_number_for_err_trap;
+    int function_line_number;
+    int return_catch_flag;
+    int funcnest;
+    int loop_level;
+    procenv_t return_catch;
+#if defined (ARRAY_VARS)
+    int fa_pushed;
+    struct func_array_state fa;
+#endif
+  };
+
+static void
+restore_func_call_state (fs)
+     struct func_call_state *fs;
+{
+#if defined (ARRAY_VARS)
+  if (fs->fa_pushed)
+    pop_funcarray_state (&fs->fa);
+#endif
+
+  loop_level = fs->loop_level;
+  funcnest = fs->funcnest;
+  this_shell_function = fs->this_shell_function;
+  dispose_command (fs->tc);
+  COPY_PROCENV (fs->return_catch, return_catch);
+  return_catch_flag = fs->return_catch_flag;
+  function_line_number = fs->function_line_number;
+  line_number_for_err_trap = fs->line_number_for_err_trap;
+  line_number = fs->line_number;
+
+  pop_context ();
+  /* This has to come after pop_context(), because the unwinding of local
+     variables may cause the restore of a local declaration of OPTIND to
+     force a getopts state reset. */
+  maybe_restore_getopt_state (fs->gs);
+
+  free (fs);
+}
+
 static int
 execute_function (var, words, flags, fds_to_close, async, subshell)
      SHELL_VAR *var;
@@ -5051,6 +5397,7 @@ execute_function (var, words, flags, fds_to_close, async, subshell)
   char *sfile, *t;
   sh_getopt_state_t *gs;
   SHELL_VAR *gv;
+  struct func_call_state *fs;
 
   USE_VAR(fc);
 
@@ -5077,6 +5424,7 @@ execute_function (var, words, flags, fds_to_close, async, subshell)
     optimize_shell_function (tc);
 
   gs = sh_getopt_save_istate ();
+  fs = (struct func_call_state *)NULL;
   if (subshell == 0)
     {
       begin_unwind_frame ("function_calling");
@@ -5087,20 +5435,22 @@ execute_function (var, words, flags, fds_to_close, async, subshell)
 	 of the standard, so I will eventually remove it from variables.c:
 	 push_var_context. */
       push_context (var->name, subshell, temporary_env);
-      /* This has to be before the pop_context(), because the unwinding of
-	 local variables may cause the restore of a local declaration of
-	 OPTIND to force a getopts state reset. */
-      add_unwind_protect (maybe_restore_getopt_state, gs);
-      add_unwind_protect (pop_context, (char *)NULL);
-      unwind_protect_int (line_number);
-      unwind_protect_int (line_number_for_err_trap);
-      unwind_protect_int (function_line_number);
-      unwind_protect_int (return_catch_flag);
-      unwind_protect_jmp_buf (return_catch);
-      add_unwind_protect (dispose_command, (char *)tc);
-      unwind_protect_pointer (this_shell_function);
-      unwind_protect_int (funcnest);
-      unwind_protect_int (loop_level);
+
+      fs = (struct func_call_state *)xmalloc (sizeof (struct func_call_state));
+      fs->gs = gs;
+      fs->tc = tc;
+      fs->this_shell_function = this_shell_function;
+      fs->line_number = line_number;
+      fs->line_number_for_err_trap = line_number_for_err_trap;
+      fs->function_line_number = function_line_number;
+      fs->return_catch_flag = return_catch_flag;
+      fs->funcnest = funcnest;
+      fs->loop_level = loop_level;
+      COPY_PROCENV (return_catch, fs->return_catch);
+#if defined (ARRAY_VARS)
+      fs->fa_pushed = 0;
+#endif
+      add_unwind_protect (restore_func_call_state, fs);
     }
   else
     push_context (var->name, subshell, temporary_env);	/* don't unwind-protect for subshells */
@@ -5172,15 +5522,17 @@ execute_function (var, words, flags, fds_to_close, async, subshell)
 #endif
 
 #if defined (ARRAY_VARS)
-  fa = (struct func_array_state *)xmalloc (sizeof (struct func_array_state));
+  /* The function call state pops these when the function returns; a
+     subshell does it itself below. */
+  fa = fs ? &fs->fa : (struct func_array_state *)xmalloc (sizeof (struct func_array_state));
   fa->source_a = (ARRAY *)bash_source_a;
   fa->source_v = bash_source_v;
   fa->lineno_a = (ARRAY *)bash_lineno_a;
   fa->lineno_v = bash_lineno_v;
   fa->funcname_a = (ARRAY *)funcname_a;
   fa->funcname_v = funcname_v;
-  if (subshell == 0)
-    add_unwind_protect (restore_funcarray_state, fa);
+  if (fs)
+    fs->fa_pushed = 1;
 #endif
 
   /* The temporary environment for a function is supposed to apply to
@@ -58,6 +58,16 @@ extern int match_ignore_case;
 extern int executing_command_builtin;
 extern int funcnest, funcnest_max;
 extern int evalnest, evalnest_max;
+extern unsigned int command_lookup_generation;
+
+/* Discard the command name lookups cached in simple commands.  Call this
+   whenever a shell function or builtin is added, removed, enabled, or
+   disabled. */
+#define INVALIDATE_COMMAND_LOOKUPS() \
+  do { \
+    if (++command_lookup_generation == 0) \
+      command_lookup_generation = 1; \
+  } while (0)
 extern int sourcenest, sourcenest_max;
 extern int stdin_redir;
 extern int line_number_for_err_trap;
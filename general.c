@@ -25,6 +25,7 @@
 #  include <sys/param.h>
 #endif
 #include "posixstat.h"
+#include "posixtime.h"
 
 #if defined (HAVE_UNISTD_H)
 #  include <unistd.h>
@@ -36,6 +37,14 @@
 #include "chartypes.h"
 #include <errno.h>
 
+#if defined (HAVE_PWD_H)
+#  include <pwd.h>
+#endif
+
+#if defined (HAVE_GRP_H)
+#  include <grp.h>
+#endif
+
 #include "bashintl.h"
 
 #include "shell.h"
@@ -45,6 +54,7 @@
 #include "test.h"
 #include "trap.h"
 #include "pathexp.h"
+#include "hashlib.h"
 
 #include "builtins/common.h"
 
@@ -65,6 +75,8 @@ extern int errno;
 static char *bash_special_tilde_expansions PARAMS((char *));
 static int unquoted_tilde_word PARAMS((const char *));
 static void initialize_group_array PARAMS((void));
+static void pwcache_free_entry PARAMS((PTR_T));
+static int pwcache_expired PARAMS((time_t));
 
 /* A standard error message to use when getcwd() returns NULL. */
 const char * const bash_getcwd_errstr = N_("getcwd: cannot access parent directories");
@@ -1089,6 +1101,21 @@ bash_special_tilde_expansions (text)
   else if (DIGIT (*text) || ((*text == '+' || *text == '-') && DIGIT (text[1])))
     result = get_dirstack_from_string (text);
 #endif
+  else
+    {
+      /* Not special; look the user up ourselves so we can remember the
+	 answer.  If there's no such user, return the unexpanded prefix,
+	 which is what the tilde library would produce, so it doesn't look
+	 in the password database again. */
+      result = sh_user_home (text);
+      if (result == 0)
+	{
+	  result = (char *)xmalloc (strlen (text) + 2);
+	  result[0] = '~';
+	  strcpy (result + 1, text);
+	  return (result);
+	}
+    }
 
   return (result ? savestring (result) : (char *)NULL);
 }
@@ -1392,6 +1419,180 @@ get_group_array (ngp)
   return group_iarray;
 }
 
+/* **************************************************************** */
+/*								    */
+/*	  Cached Password and Group Database Lookups		    */
+/*								    */
+/* **************************************************************** */
+
+/* Lookups in the password and group databases can be slow when they're
+   backed by a network service, so we remember the answers for
+   PWCACHE_TIMEOUT seconds.  `hash -r' flushes everything. */
+
+#if !defined (PWCACHE_TIMEOUT)
+#  define PWCACHE_TIMEOUT 300
+#endif
+
+typedef struct pwcache_entry {
+  char *dir;		/* home directory, NULL if no such user */
+  time_t stamp;
+} PWCACHE_ENTRY;
+
+#define PWCACHE_NBUCKETS 16
+#define PWCACHE_MAXHOMES 256	/* forget them all when there are this many */
+
+static HASH_TABLE *user_homes = (HASH_TABLE *)NULL;
+
+static char **user_names = (char **)NULL;
+static time_t user_names_stamp;
+
+static char **group_names = (char **)NULL;
+static time_t group_names_stamp;
+
+static void
+pwcache_free_entry (data)
+     PTR_T data;
+{
+  PWCACHE_ENTRY *pe;
+
+  pe = (PWCACHE_ENTRY *)data;
+  FREE (pe->dir);
+  free (pe);
+}
+
+static int
+pwcache_expired (stamp)
+     time_t stamp;
+{
+  return (NOW - stamp >= PWCACHE_TIMEOUT);
+}
+
+/* Return the home directory of user NAME, or NULL if there is no such user.
+   The return value points into the cache and should not be freed. */
+char *
+sh_user_home (name)
+     const char *name;
+{
+#if defined (HAVE_GETPWNAM)
+  BUCKET_CONTENTS *item;
+  PWCACHE_ENTRY *pe;
+  struct passwd *entry;
+
+  if (user_homes == 0)
+    user_homes = hash_create (PWCACHE_NBUCKETS);
+
+  item = hash_search (name, user_homes, 0);
+  if (item && pwcache_expired (((PWCACHE_ENTRY *)item->data)->stamp) == 0)
+    return (((PWCACHE_ENTRY *)item->data)->dir);
+
+  if (item == 0)
+    {
+      /* Misses are remembered too, so don't let the table grow without
+	 bound. */
+      if (HASH_ENTRIES (user_homes) >= PWCACHE_MAXHOMES)
+	hash_flush (user_homes, pwcache_free_entry);
+      item = hash_insert (savestring (name), user_homes, HASH_NOSRCH);
+      pe = (PWCACHE_ENTRY *)xmalloc (sizeof (PWCACHE_ENTRY));
+      pe->dir = (char *)NULL;
+      item->data = (PTR_T)pe;
+    }
+  else
+    pe = (PWCACHE_ENTRY *)item->data;
+
+  entry = getpwnam (name);
+  FREE (pe->dir);
+  pe->dir = entry ? savestring (entry->pw_dir) : (char *)NULL;
+  pe->stamp = NOW;
+#  if defined (HAVE_GETPWENT)
+  endpwent ();
+#  endif
+
+  return (pe->dir);
+#else
+  return ((char *)NULL);
+#endif
+}
+
+/* Return a NULL-terminated list of all user names in the password database,
+   for completion.  The list belongs to the cache and should not be freed. */
+char **
+sh_user_names ()
+{
+#if defined (HAVE_GETPWENT)
+  struct passwd *entry;
+  int n, size;
+
+  if (user_names && pwcache_expired (user_names_stamp) == 0)
+    return (user_names);
+
+  strvec_dispose (user_names);
+  user_names = strvec_create (size = 32);
+  n = 0;
+
+  setpwent ();
+  while (entry = getpwent ())
+    {
+      if (n + 1 >= size)
+	user_names = strvec_resize (user_names, size *= 2);
+      user_names[n++] = savestring (entry->pw_name);
+    }
+  endpwent ();
+
+  user_names[n] = (char *)NULL;
+  user_names_stamp = NOW;
+  return (user_names);
+#else
+  return ((char **)NULL);
+#endif
+}
+
+/* Return a NULL-terminated list of all group names in the group database,
+   for completion.  The list belongs to the cache and should not be freed. */
+char **
+sh_group_names ()
+{
+#if defined (HAVE_GRP_H) && !defined (__WIN32__) && !defined (__OPENNT)
+  struct group *grent;
+  int n, size;
+
+  if (group_names && pwcache_expired (group_names_stamp) == 0)
+    return (group_names);
+
+  strvec_dispose (group_names);
+  group_names = strvec_create (size = 32);
+  n = 0;
+
+  setgrent ();
+  while (grent = getgrent ())
+    {
+      if (n + 1 >= size)
+	group_names = strvec_resize (group_names, size *= 2);
+      group_names[n++] = savestring (grent->gr_name);
+    }
+  endgrent ();
+
+  group_names[n] = (char *)NULL;
+  group_names_stamp = NOW;
+  return (group_names);
+#else
+  return ((char **)NULL);
+#endif
+}
+
+/* Forget everything we've cached from the password and group databases. */
+void
+flush_pwcache ()
+{
+  if (user_homes)
+    hash_flush (user_homes, pwcache_free_entry);
+
+  strvec_dispose (user_names);
+  user_names = (char **)NULL;
+
+  strvec_dispose (group_names);
+  group_names = (char **)NULL;
+}
+
 /* **************************************************************** */
 /*								    */
 /*	  Miscellaneous functions				    */
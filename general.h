@@ -366,6 +366,11 @@ extern int group_member PARAMS((gid_t));
 extern char **get_group_list PARAMS((int *));
 extern int *get_group_array PARAMS((int *));
 
+extern char *sh_user_home PARAMS((const char *));
+extern char **sh_user_names PARAMS((void));
+extern char **sh_group_names PARAMS((void));
+extern void flush_pwcache PARAMS((void));
+
 extern char *conf_standard_path PARAMS((void));
 extern int default_columns PARAMS((void));
 
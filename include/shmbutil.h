@@ -34,6 +34,7 @@ extern size_t xmbsrtowcs PARAMS((wchar_t *, const char **, size_t, mbstate_t *))
 extern size_t xdupmbstowcs PARAMS((wchar_t **, char ***, const char *));
 
 extern size_t mbstrlen PARAMS((const char *));
+extern size_t mbsasciilen PARAMS((const char *, size_t));
 
 extern char *xstrchr PARAMS((const char *, int));
 
@@ -55,6 +56,31 @@ extern int locale_utf8locale;	/* XXX */
 #define UTF8_MBFIRSTCHAR(c)	(((c) & 0xc0) == 0xc0)
 #define UTF8_MBCHAR(c)		(((c) & 0xc0) == 0x80)
 
+/* Case mappings and classes of the first LOCALE_WTABSIZE wide characters,
+   recomputed by locale.c whenever LC_CTYPE changes.  The sh_ versions of
+   the wctype functions use them when they can; WC must not have side
+   effects. */
+#define LOCALE_WTABSIZE	256
+
+#define LOCALE_WUPPER	0x01
+#define LOCALE_WLOWER	0x02
+#define LOCALE_WALNUM	0x04
+
+extern wchar_t locale_wtoupper[];
+extern wchar_t locale_wtolower[];
+extern unsigned char locale_wclass[];
+
+#define LOCALE_WTAB_P(wc)	((unsigned long)(wc) < LOCALE_WTABSIZE)
+
+#define sh_iswupper(wc)	(LOCALE_WTAB_P (wc) ? (locale_wclass[(wc)] & LOCALE_WUPPER) : iswupper (wc))
+#define sh_iswlower(wc)	(LOCALE_WTAB_P (wc) ? (locale_wclass[(wc)] & LOCALE_WLOWER) : iswlower (wc))
+#define sh_iswalnum(wc)	(LOCALE_WTAB_P (wc) ? (locale_wclass[(wc)] & LOCALE_WALNUM) : iswalnum (wc))
+
+/* These are towupper and towlower applied only to lower and upper case
+   characters, respectively */
+#define sh_towupper(wc)	(LOCALE_WTAB_P (wc) ? locale_wtoupper[(wc)] : (iswlower (wc) ? towupper (wc) : (wc)))
+#define sh_towlower(wc)	(LOCALE_WTAB_P (wc) ? locale_wtolower[(wc)] : (iswupper (wc) ? towlower (wc) : (wc)))
+
 #else /* !HANDLE_MULTIBYTE */
 
 #undef MB_LEN_MAX
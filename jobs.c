@@ -104,7 +104,8 @@ extern int killpg PARAMS((pid_t, int));
 #define MAX_JOBS_IN_ARRAY 128		/* testing */
 #endif
 
-/* XXX for now */
+/* Minimum sizes of the pidstat hash table and the bgpids storage arena; both
+   grow (and shrink) together as CHILD_MAX changes.  Both must be powers of 2. */
 #define PIDSTAT_TABLE_SZ 4096
 #define BGPIDS_TABLE_SZ 512
 
@@ -174,7 +175,8 @@ extern void set_original_signal PARAMS((int, SigHandler *));
 static struct jobstats zerojs = { -1L, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NO_JOB, NO_JOB, 0, 0 };
 struct jobstats js = { -1L, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NO_JOB, NO_JOB, 0, 0 };
 
-ps_index_t pidstat_table[PIDSTAT_TABLE_SZ];
+ps_index_t *pidstat_table = 0;
+static ps_index_t pidstat_table_size = 0;
 struct bgpids bgpids = { 0, 0, 0, 0 };
 
 struct procchain procsubs = { 0, 0, 0 };
@@ -233,6 +235,10 @@ int check_window_size = CHECKWINSIZE_DEFAULT;
 
 PROCESS *last_procsub_child = (PROCESS *)NULL;
 
+/* If non-zero, run a SIGCHLD trap once for all the children that have exited
+   since it last ran, instead of once per child.  Set by `shopt chld_batch'. */
+int chld_batch = 0;
+
 /* Functions local to this file. */
 
 void debug_print_pgrps (void);
@@ -244,6 +250,12 @@ static sighandler sigstop_sighandler PARAMS((int));
 
 static int waitchld PARAMS((pid_t, int));
 
+static void save_chld_status PARAMS((pid_t, int));
+static int get_chld_statuses PARAMS((struct procstat *, int));
+#if defined (ARRAY_VARS)
+static void set_chld_status_arrays PARAMS((struct procstat *, int));
+#endif
+
 static PROCESS *find_pid_in_pipeline PARAMS((pid_t, PROCESS *, int));
 static PROCESS *find_pipeline PARAMS((pid_t, int, int *));
 static PROCESS *find_process PARAMS((pid_t, int, int *));
@@ -285,6 +297,7 @@ static void set_job_running PARAMS((int));
 static void setjstatus PARAMS((int));
 static int maybe_give_terminal_to PARAMS((pid_t, pid_t, int));
 static void mark_all_jobs_as_dead PARAMS((void));
+static void forget_all_jobs PARAMS((void));
 static void mark_dead_jobs_as_notified PARAMS((int));
 static void restore_sigint_handler PARAMS((void));
 #if defined (PGRP_PIPE)
@@ -305,7 +318,8 @@ static int bgp_search PARAMS((pid_t));
 static struct pipeline_saver *alloc_pipeline_saver PARAMS((void));
 
 static ps_index_t bgp_getindex PARAMS((void));
-static void bgp_resize PARAMS((void));	/* XXX */
+static void bgp_rebuild PARAMS((ps_index_t));
+static void bgp_resize PARAMS((void));
 
 #if defined (ARRAY_VARS)
 static int *pstatuses;		/* list of pipeline statuses */
@@ -345,8 +359,43 @@ static int saved_already_making_children;
    commands. */
 static int jobs_list_frozen;
 
+/* Incremented whenever a job is added or deleted or the state, flags, or
+   process statuses of a job change.  notify_of_job_status,
+   mark_dead_jobs_as_notified, and cleanup_dead_jobs remember the value they
+   saw the last time they scanned the entire jobs list, and don't rescan it
+   if nothing has changed, so a shell with many finished jobs retained for
+   `wait' doesn't pay for scanning them after every command. */
+static unsigned long jobs_generation = 1;
+
+#define JOBS_CHANGED()	(jobs_generation++)
+
+/* The value of jobs_generation and the global state that determines which
+   jobs are reported the last time notify_of_job_status scanned the jobs
+   list. */
+static unsigned long notify_generation;
+static int notify_startup_state, notify_interactive, notify_job_control;
+static int notify_subshell_env, notify_posix;
+static pid_t notify_lastasync;
+static int notify_trapdep;
+
+/* The same for mark_dead_jobs_as_notified and cleanup_dead_jobs */
+static unsigned long reap_generation, cleanup_generation;
+static long reap_childmax;
+static int reap_interactive;
+static pid_t reap_lastasync;
+
 static char retcode_name_buffer[64];
 
+/* The pids and exit statuses of children reaped while a SIGCHLD trap is set,
+   oldest first, saved by waitchld and consumed by run_sigchld_trap, which
+   makes them available to the trap in BASH_CHLD_PIDS and BASH_CHLD_STATUS.
+   This is a fixed-size circular buffer because waitchld can run in a signal
+   handler; if it fills up, the oldest entries are discarded. */
+#define CHLD_STATUS_MAX	1024
+
+static struct procstat chld_status[CHLD_STATUS_MAX];
+static int chld_status_first, chld_status_count;
+
 #if !defined (_POSIX_VERSION)
 
 /* These are definitions to map POSIX 1003.1 functions onto existing BSD
@@ -687,6 +736,7 @@ stop_pipeline (async, deferred)
 
       js.j_lastj = i;
       js.j_njobs++;
+      JOBS_CHANGED ();
     }
   else
     newjob = (JOB *)NULL;
@@ -738,10 +788,12 @@ stop_pipeline (async, deferred)
    pidstat_table:
 
    The current implementation is a hash table using a single (separate) arena
-   for storage that can be allocated and freed as a unit.  The size of the hash
-   table is a multiple of PIDSTAT_TABLE_SZ (4096) and multiple PIDs that hash
-   to the same value are chained through the bucket_next and bucket_prev
-   pointers (basically coalesced hashing for collision resolution).
+   for storage that can be allocated and freed as a unit.  The hash table has
+   as many buckets as the storage arena has cells (but at least
+   PIDSTAT_TABLE_SZ), so chains stay short no matter how large CHILD_MAX is,
+   and multiple PIDs that hash to the same value are chained through the
+   bucket_next and bucket_prev pointers (basically coalesced hashing for
+   collision resolution).
 
    bgpids.storage:
 
@@ -751,32 +803,91 @@ stop_pipeline (async, deferred)
    processes").  To avoid searching the entire storage table for a given PID,
    the hash table (pidstat_table) holds pointers into the storage arena and
    uses a doubly-linked list of cells (bucket_next/bucket_prev, also pointers
-   into the arena) to implement collision resolution. */
+   into the arena) to implement collision resolution.  When CHILD_MAX changes,
+   the arena and the hash table are rebuilt at the new size, keeping the most
+   recent statuses, so memory use tracks the retention limit instead of
+   only ever growing. */
+
+/* Reallocate bgpids.storage to hold NSIZE cells and rebuild the hash table to
+   match.  The saved statuses are copied oldest first, dropping the oldest
+   ones if there are more than will fit, so the circular buffer order and the
+   newest-first order of each hash chain are preserved. */
+static void
+bgp_rebuild (nsize)
+     ps_index_t nsize;
+{
+  struct pidstat *nstorage, *ps;
+  ps_index_t i, psi, nhead, hsize, *bucket;
+  int nskip;
+
+  nstorage = (struct pidstat *)xmalloc (nsize * sizeof (struct pidstat));
+  for (psi = 0; psi < nsize; psi++)
+    {
+      nstorage[psi].pid = NO_PID;
+      nstorage[psi].bucket_next = nstorage[psi].bucket_prev = NO_PIDSTAT;
+    }
+
+  nskip = (bgpids.npid > nsize) ? bgpids.npid - nsize : 0;
+  nhead = 0;
+  /* bgpids.head is the next cell to be reused, so it holds the oldest entry */
+  for (i = 0; i < bgpids.nalloc; i++)
+    {
+      psi = (bgpids.head + i) % bgpids.nalloc;
+      if (bgpids.storage[psi].pid == NO_PID)
+	continue;
+      if (nskip > 0)
+	{
+	  nskip--;
+	  continue;
+	}
+      nstorage[nhead].pid = bgpids.storage[psi].pid;
+      nstorage[nhead].status = bgpids.storage[psi].status;
+      nhead++;
+    }
+
+  FREE (bgpids.storage);
+  bgpids.storage = nstorage;
+  bgpids.nalloc = nsize;
+  bgpids.head = nhead & (nsize - 1);	/* oldest entry if full */
+  bgpids.npid = nhead;
+
+  hsize = (nsize < PIDSTAT_TABLE_SZ) ? PIDSTAT_TABLE_SZ : nsize;
+  if (hsize != pidstat_table_size)
+    {
+      pidstat_table = (ps_index_t *)xrealloc (pidstat_table, hsize * sizeof (ps_index_t));
+      pidstat_table_size = hsize;
+    }
+  for (psi = 0; psi < pidstat_table_size; psi++)
+    pidstat_table[psi] = NO_PIDSTAT;
+
+  /* Oldest first, so the newest entry for a given pid ends up at the head
+     of its chain. */
+  for (psi = 0; psi < nhead; psi++)
+    {
+      ps = &bgpids.storage[psi];
+      bucket = pshash_getbucket (ps->pid);
+      ps->bucket_next = *bucket;
+      if (*bucket != NO_PIDSTAT)
+	bgpids.storage[*bucket].bucket_prev = psi;
+      *bucket = psi;
+    }
+}
 
 /* The number of elements in bgpids.storage always has to be > js.c_childmax for
-   the circular buffer to work right. */
+   the circular buffer to work right.  Make the storage arena the smallest
+   power of 2 that holds js.c_childmax entries, growing or shrinking it as
+   necessary. */
 static void
 bgp_resize ()
 {
   ps_index_t nsize, nsize_cur, nsize_max;
-  ps_index_t psi;
-
-  if (bgpids.nalloc == 0)
-    {
-      /* invalidate hash table when bgpids table is reallocated */
-      for (psi = 0; psi < PIDSTAT_TABLE_SZ; psi++)
-        pidstat_table[psi] = NO_PIDSTAT;
-      nsize = BGPIDS_TABLE_SZ;	/* should be power of 2 */
-      bgpids.head = 0;
-    }
-  else
-    nsize = bgpids.nalloc;
 
   nsize_max = TYPE_MAXIMUM (ps_index_t);
   nsize_cur = (ps_index_t)js.c_childmax;
   if (nsize_cur < 0)				/* overflow */
     nsize_cur = MAX_CHILD_MAX;
 
+  nsize = BGPIDS_TABLE_SZ;
   while (nsize > 0 && nsize < nsize_cur)	/* > 0 should catch overflow */
     nsize <<= 1;
   if (nsize > nsize_max || nsize <= 0)		/* overflow? */
@@ -784,16 +895,8 @@ bgp_resize ()
   if (nsize > MAX_CHILD_MAX)
     nsize = nsize_max = MAX_CHILD_MAX;		/* hard cap */
 
-  if (bgpids.nalloc < nsize_cur && bgpids.nalloc < nsize_max)
-    {
-      bgpids.storage = (struct pidstat *)xrealloc (bgpids.storage, nsize * sizeof (struct pidstat));
-
-      for (psi = bgpids.nalloc; psi < nsize; psi++)
-	bgpids.storage[psi].pid = NO_PID;
-
-      bgpids.nalloc = nsize;
-
-    }
+  if (bgpids.nalloc != nsize)
+    bgp_rebuild (nsize);
   else if (bgpids.head >= bgpids.nalloc)	/* wrap around */
     bgpids.head = 0;
 }
@@ -804,6 +907,8 @@ bgp_getindex ()
   if (bgpids.nalloc < (ps_index_t)js.c_childmax || bgpids.head >= bgpids.nalloc)
     bgp_resize ();
 
+  if (bgpids.storage[bgpids.head].pid != NO_PID)
+    bgpids.npid--;			/* overwriting the oldest saved status */
   pshash_delindex (bgpids.head);		/* XXX - clear before reusing */
   return bgpids.head++;
 }
@@ -815,7 +920,8 @@ pshash_getbucket (pid)
   unsigned long hash;		/* XXX - u_bits32_t */
 
   hash = pid * 0x9e370001UL;
-  return (&pidstat_table[hash % PIDSTAT_TABLE_SZ]);
+  /* pidstat_table_size is always a power of 2 */
+  return (&pidstat_table[hash & (pidstat_table_size - 1)]);
 }
 
 static struct pidstat *
@@ -829,8 +935,9 @@ bgp_add (pid, status)
   /* bucket == existing chain of pids hashing to same value
      psi = where were going to put this pid/status */
 
-  bucket = pshash_getbucket (pid);	/* index into pidstat_table */
   psi = bgp_getindex ();		/* bgpids.head, index into storage */
+  bucket = pshash_getbucket (pid);	/* index into pidstat_table; after
+					   bgp_getindex, which may resize it */
 
   /* XXX - what if psi == *bucket? */
   if (psi == *bucket)
@@ -936,6 +1043,11 @@ bgp_clear ()
   bgpids.head = 0;
 
   bgpids.npid = 0;
+
+  /* bgp_rebuild reinitializes the hash table when the arena is reallocated */
+  FREE (pidstat_table);
+  pidstat_table = 0;
+  pidstat_table_size = 0;
 }
 
 /* Search for PID in the list of saved background pids; return its status if
@@ -1218,16 +1330,22 @@ cleanup_dead_jobs ()
 
   QUEUE_SIGCHLD(os);
 
-  /* XXX could use js.j_firstj and js.j_lastj here */
-  for (i = 0; i < js.j_jobslots; i++)
+  /* If no job has changed since the last time we looked, there can't be
+     any new dead jobs the user has been notified about. */
+  if (cleanup_generation != jobs_generation)
     {
-      if (i < js.j_firstj && jobs[i])
-	INTERNAL_DEBUG (("cleanup_dead_jobs: job %d non-null before js.j_firstj (%d)", i, js.j_firstj));
-      if (i > js.j_lastj && jobs[i])
-	INTERNAL_DEBUG(("cleanup_dead_jobs: job %d non-null after js.j_lastj (%d)", i, js.j_lastj));
+      /* XXX could use js.j_firstj and js.j_lastj here */
+      for (i = 0; i < js.j_jobslots; i++)
+	{
+	  if (i < js.j_firstj && jobs[i])
+	    INTERNAL_DEBUG (("cleanup_dead_jobs: job %d non-null before js.j_firstj (%d)", i, js.j_firstj));
+	  if (i > js.j_lastj && jobs[i])
+	    INTERNAL_DEBUG(("cleanup_dead_jobs: job %d non-null after js.j_lastj (%d)", i, js.j_lastj));
 
-      if (jobs[i] && DEADJOB (i) && IS_NOTIFIED (i))
-	delete_job (i, 0);
+	  if (jobs[i] && DEADJOB (i) && IS_NOTIFIED (i))
+	    delete_job (i, 0);
+	}
+      cleanup_generation = jobs_generation;
     }
 
 #if defined (PROCESS_SUBSTITUTION)
@@ -1304,6 +1422,7 @@ realloc_jobs_list ()
   nlist = (js.j_jobslots == nsize) ? jobs : (JOB **) xmalloc (nsize * sizeof (JOB *));
 
   js.c_reaped = js.j_ndead = 0;
+  JOBS_CHANGED ();
   for (i = j = 0; i < js.j_jobslots; i++)
     if (jobs[i])
       {
@@ -1407,6 +1526,7 @@ delete_job (job_index, dflags)
     }
 
   jobs[job_index] = (JOB *)NULL;
+  JOBS_CHANGED ();
   if (temp == js.j_lastmade)
     js.j_lastmade = 0;
   else if (temp == js.j_lastasync)
@@ -2066,6 +2186,7 @@ pretty_print_job (job_index, format, stream)
   /* We have printed information about this job.  When the job's
      status changes, waitchld () sets the notification flag to 0. */
   jobs[job_index]->flags |= J_NOTIFIED;
+  JOBS_CHANGED ();
 }
 
 static int
@@ -2627,7 +2748,10 @@ wait_for_single_pid (pid, flags)
   BLOCK_CHILD (set, oset);
   job = find_job (pid, 0, NULL);
   if (job != NO_JOB && jobs[job] && DEADJOB (job))
-    jobs[job]->flags |= J_NOTIFIED;
+    {
+      jobs[job]->flags |= J_NOTIFIED;
+      JOBS_CHANGED ();
+    }
   UNBLOCK_CHILD (oset);
 
   /* If running in posix mode, remove the job from the jobs table immediately */
@@ -3006,6 +3130,7 @@ itrace("wait_for: blocking wait for %d returns %d child = %p", (int)pid, r, chil
 	      if (job != NO_JOB)
 		{
 		  jobs[job]->state = JDEAD;
+		  JOBS_CHANGED ();
 		  js.c_reaped++;
 		  js.j_ndead++;
 		}
@@ -3253,7 +3378,10 @@ wait_for_job (job, flags, ps)
      for it. */
   BLOCK_CHILD (set, oset);
   if (job != NO_JOB && jobs[job] && DEADJOB (job))
-    jobs[job]->flags |= J_NOTIFIED;
+    {
+      jobs[job]->flags |= J_NOTIFIED;
+      JOBS_CHANGED ();
+    }
   UNBLOCK_CHILD (oset);
 
   if (ps)
@@ -3580,6 +3708,7 @@ start_job (job, foreground)
 
   /* You don't know about the state of this job.  Do you? */
   jobs[job]->flags &= ~J_NOTIFIED;
+  JOBS_CHANGED ();
 
   if (foreground)
     {
@@ -3639,6 +3768,7 @@ start_job (job, foreground)
   if (already_running == 0)
     {
       jobs[job]->flags |= J_NOTIFIED;
+      JOBS_CHANGED ();
       killpg (jobs[job]->pgrp, SIGCONT);
     }
 
@@ -3692,6 +3822,7 @@ kill_pid (pid, sig, group)
       if (job != NO_JOB)
 	{
 	  jobs[job]->flags &= ~J_NOTIFIED;
+	  JOBS_CHANGED ();
 
 	  /* Kill process in backquotes or one started without job control? */
 
@@ -3726,6 +3857,7 @@ kill_pid (pid, sig, group)
 		  set_job_running (job);
 		  jobs[job]->flags &= ~J_FOREGROUND;
 		  jobs[job]->flags |= J_NOTIFIED;
+		  JOBS_CHANGED ();
 		}
 	    }
 	}
@@ -3871,6 +4003,8 @@ itrace("waitchld: waitpid returns %d block = %d children_exited = %d", pid, bloc
 	{
 	  children_exited++;
 	  js.c_living--;
+	  if (signal_is_trapped (SIGCHLD) || trap_list[SIGCHLD] == (char *)IMPOSSIBLE_TRAP_HANDLER)
+	    save_chld_status (pid, process_exit_status (status));
 	}
 
       /* Locate our PROCESS for this pid. */
@@ -3903,6 +4037,7 @@ itrace("waitchld: waitpid returns %d block = %d children_exited = %d", pid, bloc
       /* Remember status, and whether or not the process is running. */
       child->status = status;
       child->running = WIFCONTINUED(status) ? PS_RUNNING : PS_DONE;
+      JOBS_CHANGED ();
 
       if (PEXITED (child))
 	{
@@ -3991,6 +4126,7 @@ set_job_status_and_cleanup (job)
 
   child = jobs[job]->pipe;
   jobs[job]->flags &= ~J_NOTIFIED;
+  JOBS_CHANGED ();
 
   call_set_current = 0;
 
@@ -4191,7 +4327,8 @@ run_sigchld_trap (nchild)
      int nchild;
 {
   char *trap_command;
-  int i;
+  int i, n, nstat;
+  struct procstat *ps;
 
   /* Turn off the trap list during the call to parse_and_execute ()
      to avoid potentially infinite recursive calls.  Preserve the
@@ -4215,6 +4352,12 @@ run_sigchld_trap (nchild)
   add_unwind_protect (xfree, trap_command);
   add_unwind_protect (maybe_set_sigchld_trap, trap_command);
 
+  /* If we're batching, run the trap once with all the saved statuses;
+     otherwise run it once per child with that child's status. */
+  ps = (struct procstat *)xmalloc (CHLD_STATUS_MAX * sizeof (struct procstat));
+  add_unwind_protect (xfree, ps);
+  n = chld_batch ? (nchild > 0) : nchild;
+
   subst_assign_varlist = (WORD_LIST *)NULL;
   the_pipeline = (PROCESS *)NULL;
   temporary_env = 0;	/* traps should not run with temporary env */
@@ -4223,8 +4366,12 @@ run_sigchld_trap (nchild)
 
   set_impossible_sigchld_trap ();
   jobs_list_frozen = 1;
-  for (i = 0; i < nchild; i++)
+  for (i = 0; i < n; i++)
     {
+      nstat = get_chld_statuses (ps, chld_batch ? CHLD_STATUS_MAX : 1);
+#if defined (ARRAY_VARS)
+      set_chld_status_arrays (ps, nstat);
+#endif
       parse_and_execute (savestring (trap_command), "trap", SEVAL_NOHIST|SEVAL_RESETLINE|SEVAL_NOOPTIMIZE);
     }
 
@@ -4232,6 +4379,81 @@ run_sigchld_trap (nchild)
   running_trap = 0;
 }
 
+/* Save PID and STATUS for the next run of the SIGCHLD trap.  Called from
+   waitchld, possibly in a signal handler, with SIGCHLD blocked. */
+static void
+save_chld_status (pid, status)
+     pid_t pid;
+     int status;
+{
+  int ind;
+
+  if (chld_status_count == CHLD_STATUS_MAX)
+    {
+      /* Discard the oldest */
+      chld_status_first = (chld_status_first + 1) % CHLD_STATUS_MAX;
+      chld_status_count--;
+    }
+  ind = (chld_status_first + chld_status_count) % CHLD_STATUS_MAX;
+  chld_status[ind].pid = pid;
+  chld_status[ind].status = status;
+  chld_status_count++;
+}
+
+/* Remove up to N of the oldest saved child statuses and copy them into PS.
+   Return the number copied. */
+static int
+get_chld_statuses (ps, n)
+     struct procstat *ps;
+     int n;
+{
+  int i;
+  sigset_t set, oset;
+
+  BLOCK_CHILD (set, oset);
+  if (n > chld_status_count)
+    n = chld_status_count;
+  for (i = 0; i < n; i++)
+    {
+      ps[i] = chld_status[chld_status_first];
+      chld_status_first = (chld_status_first + 1) % CHLD_STATUS_MAX;
+    }
+  chld_status_count -= n;
+  UNBLOCK_CHILD (oset);
+
+  return n;
+}
+
+#if defined (ARRAY_VARS)
+/* Set BASH_CHLD_PIDS and BASH_CHLD_STATUS to the N pids and statuses in PS
+   before running the SIGCHLD trap. */
+static void
+set_chld_status_arrays (ps, n)
+     struct procstat *ps;
+     int n;
+{
+  SHELL_VAR *pidv, *statv;
+  ARRAY *pida, *stata;
+  int i;
+  char *t, tbuf[INT_STRLEN_BOUND(intmax_t) + 1];
+
+  unbind_global_variable_noref ("BASH_CHLD_PIDS");
+  unbind_global_variable_noref ("BASH_CHLD_STATUS");
+  pidv = make_new_array_variable ("BASH_CHLD_PIDS");
+  statv = make_new_array_variable ("BASH_CHLD_STATUS");
+  pida = array_cell (pidv);
+  stata = array_cell (statv);
+
+  for (i = 0; i < n; i++)
+    {
+      t = inttostr (ps[i].pid, tbuf, sizeof (tbuf));
+      array_insert (pida, i, t);
+      t = inttostr (ps[i].status, tbuf, sizeof (tbuf));
+      array_insert (stata, i, t);
+    }
+}
+#endif
+
 /* Function to call when you want to notify people of changes
    in job status.  This prints out all jobs which are pending
    notification to stderr, and marks those printed as already
@@ -4258,8 +4480,23 @@ notify_of_job_status ()
   else
     queue_sigchld++;
 
+  /* If no job has changed since the last scan and neither has any of the
+     state that determines which jobs get reported, the jobs that were not
+     reported last time won't be reported this time either. */
+  if (notify_generation == jobs_generation && notify_trapdep == 0 &&
+	notify_startup_state == startup_state &&
+	notify_interactive == interactive_shell &&
+	notify_job_control == job_control &&
+	notify_subshell_env == subshell_environment &&
+	notify_posix == posixly_correct &&
+	notify_lastasync == last_asynchronous_pid)
+    job = js.j_jobslots;		/* skip the scan */
+  else
+    job = 0;
+  notify_trapdep = 0;
+
   /* XXX could use js.j_firstj here */
-  for (job = 0, dir = (char *)NULL; job < js.j_jobslots; job++)
+  for (dir = (char *)NULL; job < js.j_jobslots; job++)
     {
       if (jobs[job] && IS_NOTIFIED (job) == 0)
 	{
@@ -4287,7 +4524,10 @@ notify_of_job_status ()
 		|| termsig == SIGPIPE
 #endif
 		|| signal_is_trapped (termsig)))
-	    continue;
+	    {
+	      notify_trapdep = 1;	/* trap changes may change this */
+	      continue;
+	    }
 
 	  /* hang onto the status if the shell is running -c command */
 	  else if (startup_state == 2 && subshell_environment == 0 &&
@@ -4311,7 +4551,10 @@ notify_of_job_status ()
 		 pid until the user has been notified of its status or does
 		 a `wait'. */
 	      if (DEADJOB (job) && (interactive_shell || (find_last_pid (job, 0) != last_asynchronous_pid)))
-		jobs[job]->flags |= J_NOTIFIED;
+		{
+		  jobs[job]->flags |= J_NOTIFIED;
+		  JOBS_CHANGED ();
+		}
 	      continue;
 	    }
 
@@ -4353,6 +4596,7 @@ notify_of_job_status ()
 		    }
 		  /* foreground jobs that exit cleanly */
 		  jobs[job]->flags |= J_NOTIFIED;
+		  JOBS_CHANGED ();
 		}
 	      else if (job_control)
 		{
@@ -4373,6 +4617,7 @@ notify_of_job_status ()
 {
 internal_debug("notify_of_job_status: catch-all setting J_NOTIFIED on job %d (%d), startup state = %d", job, jobs[job]->flags, startup_state);
 		jobs[job]->flags |= J_NOTIFIED;
+		JOBS_CHANGED ();
 }
 	      break;
 
@@ -4385,6 +4630,7 @@ internal_debug("notify_of_job_status: catch-all setting J_NOTIFIED on job %d (%d
 		fprintf (stderr,
 			 _("(wd now: %s)\n"), polite_directory_format (dir));
 	      jobs[job]->flags |= J_NOTIFIED;
+	      JOBS_CHANGED ();
 	      break;
 
 	    case JRUNNING:
@@ -4396,6 +4642,15 @@ internal_debug("notify_of_job_status: catch-all setting J_NOTIFIED on job %d (%d
 	    }
 	}
     }
+
+  notify_generation = jobs_generation;
+  notify_startup_state = startup_state;
+  notify_interactive = interactive_shell;
+  notify_job_control = job_control;
+  notify_subshell_env = subshell_environment;
+  notify_posix = posixly_correct;
+  notify_lastasync = last_asynchronous_pid;
+
   if (old_ttou != 0)
     sigprocmask (SIG_SETMASK, &oset, (sigset_t *)NULL);
   else
@@ -4789,6 +5044,38 @@ delete_all_jobs (running_only)
   UNBLOCK_CHILD (oset);
 }
 
+/* Forget about all the jobs in the jobs list and all the saved background
+   pid statuses without freeing them.  This is for child processes, which
+   inherit the jobs list from the parent shell but never use it.  The
+   memory is shared with the parent until someone writes to it, and
+   freeing each job would write to, and so copy, every page holding part
+   of the list, which makes forking a child of a shell with many jobs more
+   expensive for no benefit.  The child either execs or allocates what it
+   needs from new memory. */
+static void
+forget_all_jobs ()
+{
+  sigset_t set, oset;
+
+  BLOCK_CHILD (set, oset);
+
+  jobs = (JOB **)NULL;
+  js.j_jobslots = 0;
+  js.j_firstj = js.j_lastj = js.j_njobs = 0;
+  js.j_current = js.j_previous = NO_JOB;
+  js.j_lastmade = js.j_lastasync = (JOB *)NULL;
+  js.c_injobs = js.c_reaped = js.j_ndead = 0;
+  JOBS_CHANGED ();
+
+  bgpids.storage = (struct pidstat *)NULL;
+  bgpids.nalloc = bgpids.head = 0;
+  bgpids.npid = 0;
+  pidstat_table = (ps_index_t *)NULL;
+  pidstat_table_size = 0;
+
+  UNBLOCK_CHILD (oset);
+}
+
 /* Mark all jobs in the job array so that they don't get a SIGHUP when the
    shell gets one.  If RUNNING_ONLY is nonzero, mark only running jobs. */
 void
@@ -4850,6 +5137,7 @@ mark_all_jobs_as_dead ()
     if (jobs[i])
       {
 	jobs[i]->state = JDEAD;
+	JOBS_CHANGED ();
 	js.j_ndead++;
       }
 
@@ -4880,12 +5168,28 @@ mark_dead_jobs_as_notified (force)
       for (i = 0; i < js.j_jobslots; i++)
 	{
 	  if (jobs[i] && DEADJOB (i) && (interactive_shell || (find_last_pid (i, 0) != last_asynchronous_pid)))
-	    jobs[i]->flags |= J_NOTIFIED;
+	    {
+	      jobs[i]->flags |= J_NOTIFIED;
+	      JOBS_CHANGED ();
+	    }
 	}
       UNBLOCK_CHILD (oset);
       return;
     }
 
+  if (js.c_childmax < 0)
+    set_maxchild (0);
+
+  /* If nothing has changed since the last time we counted, we've already
+     marked as many jobs as we're going to. */
+  if (reap_generation == jobs_generation && reap_childmax == js.c_childmax &&
+	reap_interactive == interactive_shell &&
+	reap_lastasync == last_asynchronous_pid)
+    {
+      UNBLOCK_CHILD (oset);
+      return;
+    }
+
   /* Mark enough dead jobs as notified to keep CHILD_MAX processes left in the
      array with the corresponding not marked as notified.  This is a better
      way to avoid pid aliasing and reuse problems than keeping the POSIX-
@@ -4915,13 +5219,15 @@ mark_dead_jobs_as_notified (force)
   if (ndead != js.j_ndead)
     INTERNAL_DEBUG (("mark_dead_jobs_as_notified: ndead (%d) != js.j_ndead (%d)", ndead, js.j_ndead));
 
-  if (js.c_childmax < 0)
-    set_maxchild (0);
+  reap_childmax = js.c_childmax;
+  reap_interactive = interactive_shell;
+  reap_lastasync = last_asynchronous_pid;
 
   /* Don't do anything if the number of dead processes is less than CHILD_MAX
      and we're not forcing a cleanup. */
   if (ndeadproc <= js.c_childmax)
     {
+      reap_generation = jobs_generation;
       UNBLOCK_CHILD (oset);
       return;
     }
@@ -4958,9 +5264,11 @@ itrace("mark_dead_jobs_as_notified: child_max = %d ndead = %d ndeadproc = %d", j
 	  if ((ndeadproc -= processes_in_job (i)) <= js.c_childmax)
 	    break;
 	  jobs[i]->flags |= J_NOTIFIED;
+	  JOBS_CHANGED ();
 	}
     }
 
+  reap_generation = jobs_generation;
   UNBLOCK_CHILD (oset);
 }
 
@@ -5038,7 +5346,7 @@ without_job_control ()
 #if defined (PGRP_PIPE)
   sh_closepipe (pgrp_pipe);
 #endif
-  delete_all_jobs (0);
+  forget_all_jobs ();
   set_job_control (0);
 }
 
@@ -5096,6 +5404,17 @@ set_maxchild (nchild)
     nchild = MAX_CHILD_MAX;
 
   js.c_childmax = nchild;
+
+  /* Resize the saved status table now, so lowering CHILD_MAX releases
+     memory immediately instead of waiting for the next status to be saved. */
+  if (bgpids.nalloc > 0)
+    {
+      sigset_t set, oset;
+
+      BLOCK_CHILD (set, oset);
+      bgp_resize ();
+      UNBLOCK_CHILD (oset);
+    }
 }
 
 /* Set the handler to run when the shell receives a SIGCHLD signal. */
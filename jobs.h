@@ -218,6 +218,7 @@ extern volatile pid_t last_made_pid, last_asynchronous_pid;
 extern int asynchronous_notification;
 
 extern int already_making_children;
+extern int chld_batch;
 extern int running_in_background;
 
 extern PROCESS *last_procsub_child;
@@ -562,7 +562,7 @@ posix_cclass_only (pattern)
 }      
 
 /* Now include `sm_loop.c' for multibyte characters. */
-#define FOLD(c) ((flags & FNM_CASEFOLD) && iswupper (c) ? towlower (c) : (c))
+#define FOLD(c) ((flags & FNM_CASEFOLD) ? sh_towlower (c) : (c))
 
 #  if !defined (__CYGWIN__)
 #    define ISDIRSEP(c)	((c) == L'/')
@@ -43,15 +43,17 @@
 
 #include <glob/strmatch.h>
 
-#define _to_wupper(wc)	(iswlower (wc) ? towupper (wc) : (wc))
-#define _to_wlower(wc)	(iswupper (wc) ? towlower (wc) : (wc))
+#if defined (HANDLE_MULTIBYTE)
+#  define _to_wupper(wc)	(sh_towupper (wc))
+#  define _to_wlower(wc)	(sh_towlower (wc))
+#endif
 
 #if !defined (HANDLE_MULTIBYTE)
 #  define cval(s, i, l)	((s)[(i)])
-#  define iswalnum(c)	(isalnum(c))
+#  define sh_iswalnum(c)	(isalnum(c))
 #  define TOGGLE(x)	(ISUPPER (x) ? tolower ((unsigned char)x) : (TOUPPER (x)))
 #else
-#  define TOGGLE(x)	(iswupper (x) ? towlower (x) : (_to_wupper(x)))
+#  define TOGGLE(x)	(sh_iswupper (x) ? sh_towlower (x) : (_to_wupper(x)))
 #endif
 
 /* These must agree with the defines in externs.h */
@@ -83,7 +85,7 @@ cval (s, i, l)
   wchar_t wc;
   mbstate_t mps;  
 
-  if (MB_CUR_MAX == 1 || is_basic (s[i]))
+  if (locale_mb_cur_max == 1 || is_basic (s[i]))
     return ((wchar_t)s[i]);
   if (i >= (l - 1))
     return ((wchar_t)s[i]);
@@ -143,7 +145,7 @@ sh_modcase (string, pat, flags)
     {
       wc = cval ((char *)string, start, end);
 
-      if (iswalnum (wc) == 0)
+      if (sh_iswalnum (wc) == 0)
 	inword = 0;
 
       if (pat)
@@ -66,6 +66,51 @@ _path_readlink (path, buf, bufsiz)
 
 #define DOUBLE_SLASH(p)	((p[0] == '/') && (p[1] == '/') && p[2] != '/')
 
+#if defined (O_PATH) && defined (HAVE_READLINK) && defined (__linux__)
+#  define KERNEL_PHYSPATH
+#endif
+
+#if defined (KERNEL_PHYSPATH)
+/* Let the kernel resolve PATH: open it without reading it and ask /proc
+   for the name of the resulting file descriptor.  This takes a constant
+   number of system calls instead of one readlink per pathname component,
+   which matters on automounted and network file systems.  Returns NULL,
+   leaving the component-by-component walk to produce the result and set
+   errno, if PATH can't be opened or the kernel's name isn't usable. */
+static char *
+_path_kernelpath (path)
+     char *path;
+{
+  char fdpath[32], *result;
+  int fd, len, e;
+
+  e = errno;
+  fd = open (path, O_PATH|O_CLOEXEC);
+  if (fd < 0)
+    {
+      errno = e;
+      return ((char *)NULL);
+    }
+  sprintf (fdpath, "/proc/self/fd/%d", fd);
+  result = (char *)xmalloc (PATH_MAX + 1);
+  len = readlink (fdpath, result, PATH_MAX);
+  close (fd);
+  errno = e;
+
+  /* Anything other than an absolute pathname (e.g., a file outside our
+     root directory) or a file that's been removed out from under us goes
+     the slow way. */
+  if (len <= 0 || len >= PATH_MAX || result[0] != '/' ||
+	(len > 10 && STREQ (result + len - 10, " (deleted)")))
+    {
+      free (result);
+      return ((char *)NULL);
+    }
+  result[len] = '\0';
+  return (result);
+}
+#endif
+
 /*
  * Return PATH with all symlinks expanded in newly-allocated memory.
  * This always gets an absolute pathname.
@@ -82,6 +127,17 @@ sh_physpath (path, flags)
 
   linklen = strlen (path);
 
+#if defined (KERNEL_PHYSPATH)
+  /* POSIX leaves the meaning of a leading `//' up to the implementation,
+     and the kernel's name for the file won't preserve it. */
+  if (linklen < PATH_MAX && path[0] == '/' && DOUBLE_SLASH (path) == 0)
+    {
+      result = _path_kernelpath (path);
+      if (result)
+	return (result);
+    }
+#endif
+
 #if 0
   /* First sanity check -- punt immediately if the name is too long. */
   if (linklen >= PATH_MAX)
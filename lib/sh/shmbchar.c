@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <limits.h>
 
+#include <bashansi.h>
+
 #include <errno.h>
 
 #include <shmbutil.h>
@@ -48,6 +50,39 @@ extern int locale_utf8locale;
 extern char *utf8_mbsmbchar (const char *);
 extern int utf8_mblen (const char *, size_t);
 
+#define ASCII_HIGHS	((unsigned long)-1 / 0xff * 0x80)	/* 0x8080...80 */
+
+/* Return the number of bytes at the start of S, whose length is LEN, that
+   are ASCII characters: S[mbsasciilen(S, LEN)] is either the terminating NUL
+   or the first byte with the eighth bit set.  Once S is aligned, this checks
+   a word at a time, as long as the whole word is within the string. */
+size_t
+mbsasciilen (s, len)
+     const char *s;
+     size_t len;
+{
+  const unsigned char *p, *end;
+  unsigned long w;
+
+  end = (const unsigned char *)s + len;
+  for (p = (const unsigned char *)s; p < end && ((size_t)p % sizeof (w)) != 0; p++)
+    if (*p & 0x80)
+      return (p - (const unsigned char *)s);
+
+  /* A word with a byte with the eighth bit set has the high bit of that
+     byte set in W.  There are no NULs before END. */
+  for ( ; (size_t)(end - p) >= sizeof (w); p += sizeof (w))
+    {
+      memcpy (&w, p, sizeof (w));
+      if ((w & ASCII_HIGHS) != 0)
+	break;
+    }
+
+  while (p < end && (*p & 0x80) == 0)
+    p++;
+  return (p - (const unsigned char *)s);
+}
+
 /* Count the number of characters in S, counting multi-byte characters as a
    single character. */
 size_t
@@ -59,6 +94,15 @@ mbstrlen (s)
   int f, mb_cur_max;
 
   nc = 0;
+  /* In UTF-8, each ASCII byte is a character by itself */
+  if (locale_utf8locale)
+    {
+      nc = mbsasciilen (s, strlen (s));
+      s += nc;
+      if (*s == 0)
+	return nc;
+    }
+
   mb_cur_max = MB_CUR_MAX;
   while (*s && (clen = (f = is_basic (*s)) ? 1 : mbrlen(s, mb_cur_max, &mbs)) != 0)
     {
@@ -54,7 +54,7 @@ utf8_mbsmbchar (str)
 {
   register char *s;
 
-  for (s = (char *)str; *s; s++)
+  for (s = (char *)str + mbsasciilen (str, strlen (str)); *s; s++)
     if ((*s & 0xc0) == 0x80)
       return s;
   return (0);
@@ -34,6 +34,7 @@
 #include "bashansi.h"
 #include <stdio.h>
 #include "chartypes.h"
+#include "shmbutil.h"
 #include <errno.h>
 
 #include "shell.h"
@@ -47,6 +48,19 @@ int locale_utf8locale;
 int locale_mb_cur_max;	/* value of MB_CUR_MAX for current locale (LC_CTYPE) */
 int locale_shiftstates = 0;
 
+#if defined (HANDLE_MULTIBYTE)
+/* Case mappings and character classes for the first LOCALE_WTABSIZE wide
+   characters in the current LC_CTYPE locale, so the shell doesn't have to
+   call the wctype functions for every character. */
+wchar_t locale_wtoupper[LOCALE_WTABSIZE];
+wchar_t locale_wtolower[LOCALE_WTABSIZE];
+unsigned char locale_wclass[LOCALE_WTABSIZE];
+#endif
+
+/* The decimal point character for the current LC_NUMERIC locale, or 0 if
+   we have to look it up again */
+static int decpoint_char = 0;
+
 int singlequote_translations = 0;	/* single-quote output of $"..." */
 
 extern int dump_translatable_strings, dump_po_strings;
@@ -71,6 +85,7 @@ static char *lang;
 static int reset_locale_vars PARAMS((void));
 
 static void locale_setblanks PARAMS((void));
+static void locale_setwtables PARAMS((void));
 static int locale_isutf8 PARAMS((char *));
 
 /* Set the value of default_locale and make the current locale the
@@ -95,6 +110,7 @@ set_default_locale ()
 #else
   locale_shiftstates = 0;
 #endif
+  locale_setwtables ();
 }
 
 /* Set default values for LC_CTYPE, LC_COLLATE, LC_MESSAGES, LC_NUMERIC and
@@ -113,6 +129,7 @@ set_default_locale_vars ()
     {
       setlocale (LC_CTYPE, lc_all);
       locale_setblanks ();
+      locale_setwtables ();
       locale_mb_cur_max = MB_CUR_MAX;
       locale_utf8locale = locale_isutf8 (lc_all);
 
@@ -141,7 +158,10 @@ set_default_locale_vars ()
 #  if defined (LC_NUMERIC)
   val = get_string_value ("LC_NUMERIC");
   if (val == 0 && lc_all && *lc_all)
-    setlocale (LC_NUMERIC, lc_all);
+    {
+      setlocale (LC_NUMERIC, lc_all);
+      decpoint_char = 0;
+    }
 #  endif /* LC_NUMERIC */
 
 #  if defined (LC_TIME)
@@ -221,6 +241,8 @@ set_locale_var (var, value)
 	    internal_warning(_("setlocale: LC_ALL: cannot change locale (%s): %s"), lc_all, strerror (errno));
 	}
       locale_setblanks ();
+      locale_setwtables ();
+      decpoint_char = 0;
       locale_mb_cur_max = MB_CUR_MAX;
       /* if LC_ALL == "", reset_locale_vars has already called this */
       if (*lc_all && x)
@@ -245,6 +267,7 @@ set_locale_var (var, value)
 	{
 	  x = setlocale (LC_CTYPE, get_locale_var ("LC_CTYPE"));
 	  locale_setblanks ();
+	  locale_setwtables ();
 	  locale_mb_cur_max = MB_CUR_MAX;
 	  /* if setlocale() returns NULL, the locale is not changed */
 	  if (x)
@@ -277,6 +300,7 @@ set_locale_var (var, value)
 #  if defined (LC_NUMERIC)
       if (lc_all == 0 || *lc_all == '\0')
 	x = setlocale (LC_NUMERIC, get_locale_var ("LC_NUMERIC"));
+      decpoint_char = 0;
 #  endif /* LC_NUMERIC */
     }
   else if (var[3] == 'T' && var[4] == 'I')	/* LC_TIME */
@@ -387,6 +411,8 @@ reset_locale_vars ()
 #  endif
 
   locale_setblanks ();  
+  locale_setwtables ();
+  decpoint_char = 0;
   locale_mb_cur_max = MB_CUR_MAX;
   if (x)
     locale_utf8locale = locale_isutf8 (x);
@@ -591,6 +617,31 @@ locale_setblanks ()
     }
 }
 
+/* Recompute the wide character case mapping and class tables when the
+   locale changes. */
+static void
+locale_setwtables ()
+{
+#if defined (HANDLE_MULTIBYTE)
+  wint_t wc;
+  int f;
+
+  for (wc = 0; wc < LOCALE_WTABSIZE; wc++)
+    {
+      f = 0;
+      if (iswupper (wc))
+	f |= LOCALE_WUPPER;
+      if (iswlower (wc))
+	f |= LOCALE_WLOWER;
+      if (iswalnum (wc))
+	f |= LOCALE_WALNUM;
+      locale_wclass[wc] = f;
+      locale_wtoupper[wc] = (f & LOCALE_WLOWER) ? towupper (wc) : wc;
+      locale_wtolower[wc] = (f & LOCALE_WUPPER) ? towlower (wc) : wc;
+    }
+#endif
+}
+
 /* Parse a locale specification
      language[_territory][.codeset][@modifier][+special][,[sponsor][_revision]]
    and return TRUE if the codeset is UTF-8 or utf8 */
@@ -632,8 +683,11 @@ locale_decpoint ()
 {
   struct lconv *lv;
 
+  if (decpoint_char)
+    return decpoint_char;
   lv = localeconv ();
-  return (lv && lv->decimal_point && lv->decimal_point[0]) ? lv->decimal_point[0] : '.';
+  decpoint_char = (lv && lv->decimal_point && lv->decimal_point[0]) ? lv->decimal_point[0] : '.';
+  return decpoint_char;
 }
 #else
 #  undef locale_decpoint
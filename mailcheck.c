@@ -33,6 +33,15 @@
 #include "bashansi.h"
 #include "bashintl.h"
 
+#if defined (HAVE_SYS_INOTIFY_H) && defined (HAVE_INOTIFY_INIT1)
+#  define MAIL_INOTIFY
+#  include <sys/inotify.h>
+#  if defined (HAVE_SYS_VFS_H)
+#    include <sys/vfs.h>
+#  endif
+#  include <errno.h>
+#endif
+
 #include "shell.h"
 #include "execute_cmd.h"
 #include "mailcheck.h"
@@ -40,6 +49,7 @@
 
 /* Values for flags word in struct _fileinfo */
 #define MBOX_INITIALIZED	0x01
+#define MBOX_CHANGED		0x02	/* inotify says look at it again */
 
 extern time_t shell_start_time;
 
@@ -52,6 +62,8 @@ typedef struct _fileinfo {
   time_t mod_time;
   off_t file_size;
   int flags;
+  int wd;		/* inotify watch on the file's directory, or -1 */
+  char *base;		/* name of the file within that directory */
 } FILEINFO;
 
 /* The list of remembered mail files. */
@@ -80,6 +92,16 @@ static int file_has_grown PARAMS((int));
 
 static char *parse_mailpath_spec PARAMS((char *));
 
+#if defined (MAIL_INOTIFY)
+static int network_filesystem PARAMS((const char *));
+static void watch_mail_file PARAMS((FILEINFO *));
+static void read_mail_events PARAMS((void));
+
+/* inotify file descriptor watching the directories containing the mail
+   files, so check_mail only has to stat the files that have changed. */
+static int mail_ifd = -1;
+#endif
+
 /* Returns non-zero if it is time to check mail. */
 int
 time_to_check_mail ()
@@ -150,6 +172,9 @@ init_mail_file (i)
   mailfiles[i]->access_time = mailfiles[i]->mod_time = last_time_mail_checked ? last_time_mail_checked : shell_start_time;
   mailfiles[i]->file_size = 0;
   mailfiles[i]->flags = 0;
+#if defined (MAIL_INOTIFY)
+  watch_mail_file (mailfiles[i]);
+#endif
 }
 
 static void
@@ -204,7 +229,10 @@ reset_mail_files ()
   register int i;
 
   for (i = 0; i < mailfiles_count; i++)
-    RESET_MAIL_FILE (i);
+    {
+      RESET_MAIL_FILE (i);
+      mailfiles[i]->flags |= MBOX_CHANGED;
+    }
 }
 
 static FILEINFO *
@@ -217,6 +245,8 @@ alloc_mail_file (filename, msg)
   mf->name = filename;
   mf->msg = msg ? savestring (msg) : (char *)NULL;
   mf->flags = 0;
+  mf->wd = -1;
+  mf->base = (char *)NULL;
 
   return mf;
 }
@@ -244,6 +274,13 @@ free_mail_files ()
 
   mailfiles_count = 0;
   mailfiles = (FILEINFO **)NULL;
+
+#if defined (MAIL_INOTIFY)
+  /* Closing the descriptor removes all the watches */
+  if (mail_ifd >= 0)
+    close (mail_ifd);
+  mail_ifd = -1;
+#endif
 }
 
 void
@@ -315,6 +352,130 @@ file_has_grown (i)
   return ((mailstat (file, &finfo) == 0) && (finfo.st_size > size));
 }
 
+#if defined (MAIL_INOTIFY)
+/* Return non-zero if PATH is on a filesystem where inotify doesn't report
+   changes made by other hosts, so we have to keep polling it. */
+static int
+network_filesystem (path)
+     const char *path;
+{
+#if defined (HAVE_SYS_VFS_H)
+  struct statfs fsinfo;
+
+  if (statfs (path, &fsinfo) < 0)
+    return 1;
+
+  switch ((unsigned long)fsinfo.f_type)
+    {
+    case 0x6969:		/* NFS */
+    case 0x517b:		/* SMB */
+    case 0xff534d42:		/* CIFS */
+    case 0xfe534d42:		/* SMB2 */
+    case 0x73757245:		/* CODA */
+    case 0x5346414f:		/* AFS */
+    case 0x6b414653:		/* kAFS */
+    case 0x01021997:		/* 9P */
+    case 0x00c36400:		/* CEPH */
+    case 0x65735546:		/* FUSE */
+      return 1;
+    default:
+      return 0;
+    }
+#else
+  return 1;
+#endif
+}
+
+/* Start watching the directory containing MF for changes to MF.  If we
+   can't, MF->wd stays -1 and check_mail stats it every time. */
+static void
+watch_mail_file (mf)
+     FILEINFO *mf;
+{
+  struct stat finfo;
+  char *dir;
+
+  mf->wd = -1;
+  mf->flags |= MBOX_CHANGED;		/* look at it the first time */
+
+  mf->base = strrchr (mf->name, '/');
+  if (mf->base == 0 || mf->base[1] == '\0')
+    return;
+  mf->base++;
+
+  /* Maildir-style mailboxes are directories, and a symlink's target can
+     change without any event in the link's directory; keep polling those */
+  if (lstat (mf->name, &finfo) == 0 && (S_ISDIR (finfo.st_mode) || S_ISLNK (finfo.st_mode)))
+    return;
+
+  dir = substring (mf->name, 0, (mf->base - mf->name > 1) ? mf->base - mf->name - 1 : 1);
+  if (network_filesystem (dir) == 0)
+    {
+      if (mail_ifd < 0)
+	mail_ifd = inotify_init1 (IN_NONBLOCK|IN_CLOEXEC);
+      if (mail_ifd >= 0)
+	mf->wd = inotify_add_watch (mail_ifd, dir,
+				    IN_MODIFY|IN_ATTRIB|IN_ACCESS|IN_CLOSE_WRITE|
+				    IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|
+				    IN_DELETE_SELF|IN_MOVE_SELF);
+    }
+  free (dir);
+}
+
+/* Read any pending inotify events and mark the mail files they refer to
+   as changed.  If we lose track of a directory or events, mark every
+   affected file and let it be polled. */
+static void
+read_mail_events ()
+{
+  char buf[4096], *p;
+  struct inotify_event *ev;
+  ssize_t n;
+  int i, all;
+
+  all = 0;
+  while ((n = read (mail_ifd, buf, sizeof (buf))) > 0)
+    {
+      for (p = buf; p < buf + n; p += sizeof (struct inotify_event) + ev->len)
+	{
+	  ev = (struct inotify_event *)p;
+	  if (ev->mask & IN_Q_OVERFLOW)
+	    {
+	      all = 1;
+	      continue;
+	    }
+	  for (i = 0; i < mailfiles_count; i++)
+	    {
+	      if (mailfiles[i]->wd != ev->wd)
+		continue;
+	      if (ev->mask & (IN_IGNORED|IN_DELETE_SELF|IN_MOVE_SELF|IN_UNMOUNT))
+		{
+		  /* The directory is gone; poll from now on */
+		  mailfiles[i]->wd = -1;
+		  mailfiles[i]->flags |= MBOX_CHANGED;
+		}
+	      else if (ev->len && STREQ (ev->name, mailfiles[i]->base))
+		mailfiles[i]->flags |= MBOX_CHANGED;
+	    }
+	}
+    }
+
+  if (n < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      /* Something's wrong with the descriptor; go back to polling */
+      close (mail_ifd);
+      mail_ifd = -1;
+      for (i = 0; i < mailfiles_count; i++)
+	mailfiles[i]->wd = -1;
+      all = 1;
+    }
+
+  if (all)
+    for (i = 0; i < mailfiles_count; i++)
+      mailfiles[i]->flags |= MBOX_CHANGED;
+}
+#endif /* MAIL_INOTIFY */
+
 /* Take an element from $MAILPATH and return the portion from
    the first unquoted `?' or `%' to the end of the string.  This is the
    message to be printed when the file contents change. */
@@ -420,6 +581,11 @@ check_mail ()
   int i, use_user_notification;
   char *dollar_underscore, *temp;
 
+#if defined (MAIL_INOTIFY)
+  if (mail_ifd >= 0)
+    read_mail_events ();
+#endif
+
   dollar_underscore = get_string_value ("_");
   if (dollar_underscore)
     dollar_underscore = savestring (dollar_underscore);
@@ -431,6 +597,13 @@ check_mail ()
       if (*current_mail_file == '\0')
 	continue;
 
+#if defined (MAIL_INOTIFY)
+      /* Nothing to do if we're watching the file and it hasn't changed */
+      if (mailfiles[i]->wd >= 0 && (mailfiles[i]->flags & MBOX_CHANGED) == 0)
+	continue;
+      mailfiles[i]->flags &= ~MBOX_CHANGED;
+#endif
+
       if (file_mod_date_changed (i))
 	{
 	  int file_is_bigger;
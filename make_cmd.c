@@ -363,6 +363,12 @@ make_case_command (word, clauses, lineno)
   temp->line = lineno;
   temp->word = word;
   temp->clauses = REVERSE_LIST (clauses, PATTERN_LIST *);
+  temp->dispatch = (CASE_DISPATCH *)xmalloc (sizeof (CASE_DISPATCH));
+  temp->dispatch->refcount = 1;
+  temp->dispatch->nclauses = -1;
+  temp->dispatch->clause_start = (int *)NULL;
+  temp->dispatch->patterns = temp->dispatch->literals = (char **)NULL;
+  temp->dispatch->literal_clauses = (HASH_TABLE *)NULL;
   return (make_command (cm_case, (SIMPLE_COM *)temp));
 }
 
@@ -505,6 +511,11 @@ make_bare_simple_command ()
   temp->line = line_number;
   temp->words = (WORD_LIST *)NULL;
   temp->redirects = (REDIRECT *)NULL;
+  temp->lookup_gen = 0;
+  temp->lookup_func = (SHELL_VAR *)NULL;
+  temp->lookup_builtin = (struct builtin *)NULL;
+  temp->words_gen = 0;
+  temp->test_comp = (struct test_compiled *)NULL;
 
   command->type = cm_simple;
   command->redirects = (REDIRECT *)NULL;
@@ -202,6 +202,7 @@ static int token_is_assignment PARAMS((char *, int));
 static int token_is_ident PARAMS((char *, int));
 #endif
 static int read_token_word PARAMS((int));
+static int read_word_chars PARAMS((int, int *));
 static void discard_parser_constructs PARAMS((int));
 
 static char *error_token_from_token PARAMS((int));
@@ -2870,6 +2871,10 @@ static char *token = (char *)NULL;
 /* Current size of the token buffer. */
 static size_t token_buffer_size;
 
+/* A token buffer saved for reuse by the next save_parser_state */
+static char *spare_token = (char *)NULL;
+static size_t spare_token_size;
+
 /* Command to read_token () explaining what we want it to do. */
 #define READ 0
 #define RESET 1
@@ -4381,7 +4386,9 @@ xparse_dolparen (base, string, indp, flags)
 
 /* Recursively call the parser to parse the string from a $(...) command
    substitution to a COMMAND *. This is called from command_substitute() and
-   has the same parser state constraints as xparse_dolparen(). */
+   has the same parser state constraints as xparse_dolparen(). Returns NULL
+   unless STRING parses to a single command; parse_and_execute would parse
+   and run a list of newline-separated commands one at a time. */
 COMMAND *
 parse_string_to_command (string, flags)
      char *string;
@@ -4402,7 +4409,7 @@ parse_string_to_command (string, flags)
 
 /*itrace("parse_string_to_command: size = %d shell_input_line = `%s' string=`%s'", shell_input_line_size, shell_input_line, string);*/
 
-  sflags = SEVAL_NONINT|SEVAL_NOHIST|SEVAL_NOFREE;
+  sflags = SEVAL_NONINT|SEVAL_NOHIST|SEVAL_NOFREE|SEVAL_ONECMD;
   if (flags & SX_NOLONGJMP)
     sflags |= SEVAL_NOLONGJMP;
 
@@ -4858,6 +4865,56 @@ token_is_ident (t, i)
 }
 #endif
 
+/* Characters that read_token_word has to look at individually: they end
+   the word, begin a quoted string or expansion, or are special in some
+   other context ('[' and '=' for assignments, extglob pattern characters
+   before a `(', CTLESC and CTLNUL).  Everything else is appended to the
+   token unchanged. */
+#define WORDCHAR_SPECIAL	(CSHBRK|CXQUOTE|CEXP|CSPECL)
+
+/* Fast path for read_token_word: append the ordinary word characters at
+   the current position in shell_input_line to TOKEN, starting at index
+   TOKEN_INDEX, without calling shell_getc for each one.  Stops at the end
+   of the line, leaving anything special to shell_getc.  Updates
+   *ALL_DIGITP and returns the new token index. */
+static int
+read_word_chars (token_index, all_digitp)
+     int token_index;
+     int *all_digitp;
+{
+  register unsigned char *s;
+  register int n, c;
+  int digits;
+
+  if (shell_input_line == 0 || eol_ungetc_lookahead)
+    return token_index;
+
+  s = (unsigned char *)shell_input_line + shell_input_line_index;
+  digits = *all_digitp;
+  for (n = 0; (c = s[n]); n++)
+    {
+      if ((sh_syntaxtab[c] & WORDCHAR_SPECIAL) || c == '[' || c == '=')
+	break;
+#if defined (EXTENDED_GLOB)
+      if (extended_glob && PATTERN_CHAR (c))
+	break;
+#endif
+      digits &= DIGIT (c);
+    }
+
+  if (n == 0)
+    return token_index;
+
+  RESIZE_MALLOCED_BUFFER (token, token_index, n + 1, token_buffer_size,
+			  TOKEN_DEFAULT_GROW_SIZE);
+  memcpy (token + token_index, s, n);
+  shell_input_line_index += n;
+  unquoted_backslash = 0;
+  *all_digitp = digits;
+
+  return (token_index + n);
+}
+
 static int
 read_token_word (character)
      int character;
@@ -5222,6 +5279,11 @@ got_escaped_character:
       if (character == '\n' && SHOULD_PROMPT ())
 	prompt_again (0);
 
+      /* Copy any run of ordinary word characters directly from
+	 shell_input_line rather than one at a time through shell_getc. */
+      if (pass_next_character == 0)
+	token_index = read_word_chars (token_index, &all_digit_token);
+
       /* We want to remove quoted newlines (that is, a \<newline> pair)
 	 unless we are within single quotes or pass_next_character is
 	 set (the shell equivalent of literal-next). */
@@ -6501,8 +6563,6 @@ parse_compound_assignment (retlenp)
      expansion won't happen. */
   last_read_token = WORD;
 
-  token = (char *)NULL;
-  token_buffer_size = 0;
   wl = (WORD_LIST *)NULL;	/* ( */
 
   assignok = parser_state&PST_ASSIGNOK;		/* XXX */
@@ -6587,7 +6647,10 @@ save_parser_state (ps)
     return ((sh_parser_state_t *)NULL);
 
   ps->parser_state = parser_state;
-  ps->token_state = save_token_state ();
+  ps->token_state[0] = last_read_token;
+  ps->token_state[1] = token_before_that;
+  ps->token_state[2] = two_tokens_ago;
+  ps->token_state[3] = current_token;
 
   ps->input_line_terminator = shell_input_line_terminator;
   ps->eof_encountered = eof_encountered;
@@ -6606,7 +6669,10 @@ save_parser_state (ps)
 
   ps->last_command_exit_value = last_command_exit_value;
 #if defined (ARRAY_VARS)
-  ps->pipestatus = save_pipestatus_array ();
+  /* Copying PIPESTATUS is the expensive part of saving the parser state,
+     so keep the values in PS if we can and only copy the array if not. */
+  ps->npipestatus = save_pipestatus_values (ps->pipestatus_vals, PSTATUS_SAVE_MAX);
+  ps->pipestatus = (ps->npipestatus < 0) ? save_pipestatus_array () : (ARRAY *)NULL;
 #endif
     
   ps->last_shell_builtin = last_shell_builtin;
@@ -6632,9 +6698,12 @@ save_parser_state (ps)
   ps->eof_token = shell_eof_token;
   ps->token = token;
   ps->token_buffer_size = token_buffer_size;
-  /* Force reallocation on next call to read_token_word */
-  token = 0;
-  token_buffer_size = 0;
+  /* Give read_token_word a buffer of its own, reusing one left over from a
+     previous nested parse if we have it. */
+  token = spare_token;
+  token_buffer_size = spare_token_size;
+  spare_token = 0;
+  spare_token_size = 0;
 
   return (ps);
 }
@@ -6649,11 +6718,10 @@ restore_parser_state (ps)
     return;
 
   parser_state = ps->parser_state;
-  if (ps->token_state)
-    {
-      restore_token_state (ps->token_state);
-      free (ps->token_state);
-    }
+  last_read_token = ps->token_state[0];
+  token_before_that = ps->token_state[1];
+  two_tokens_ago = ps->token_state[2];
+  current_token = ps->token_state[3];
 
   shell_input_line_terminator = ps->input_line_terminator;
   eof_encountered = ps->eof_encountered;
@@ -6672,7 +6740,10 @@ restore_parser_state (ps)
 
   last_command_exit_value = ps->last_command_exit_value;
 #if defined (ARRAY_VARS)
-  restore_pipestatus_array (ps->pipestatus);
+  if (ps->npipestatus >= 0)
+    restore_pipestatus_values (ps->pipestatus_vals, ps->npipestatus);
+  else
+    restore_pipestatus_array (ps->pipestatus);
 #endif
 
   last_shell_builtin = ps->last_shell_builtin;
@@ -6700,7 +6771,20 @@ restore_parser_state (ps)
   pushed_string_list = (STRING_SAVER *)ps->pushed_strings;
 #endif
 
-  FREE (token);
+  /* Keep the larger of the nested parse's token buffer and the spare for
+     the next save_parser_state */
+  if (spare_token && spare_token_size < token_buffer_size)
+    {
+      free (spare_token);
+      spare_token = 0;
+    }
+  if (spare_token == 0)
+    {
+      spare_token = token;
+      spare_token_size = token_buffer_size;
+    }
+  else
+    FREE (token);
   token = ps->token;
   token_buffer_size = ps->token_buffer_size;
   shell_eof_token = ps->eof_token;
@@ -44,8 +44,10 @@
 #include "flags.h"
 #include <y.tab.h>	/* use <...> so we pick it up from the build directory */
 #include "input.h"
+#include "execute_cmd.h"
 
 #include "shmbutil.h"
+#include "posixtime.h"
 
 #include "builtins/common.h"
 
@@ -73,6 +75,13 @@ static void indent PARAMS((int));
 static void semicolon PARAMS((void));
 static void the_printed_command_resize PARAMS((int));
 
+static void xtrace_begin PARAMS((int));
+static void xtrace_add PARAMS((const char *, int));
+static void xtrace_sep PARAMS((void));
+static void xtrace_field PARAMS((char *, int));
+static void xtrace_end PARAMS((void));
+static void xtrace_words PARAMS((WORD_LIST *, int));
+
 static void make_command_string_internal PARAMS((COMMAND *));
 static void _print_word_list PARAMS((WORD_LIST *, char *, PFUNC *));
 static void command_print_word_list PARAMS((WORD_LIST *, char *));
@@ -115,6 +124,20 @@ FILE *xtrace_fp = 0;
 
 #define CHECK_XTRACE_FP	xtrace_fp = (xtrace_fp ? xtrace_fp : stderr)
 
+/* Non-zero means to write xtrace output as records: a header with the
+   time, pid, indirection level, and source file and line, followed by
+   each word as a length-prefixed field.  Set by `shopt xtrace_structured'. */
+int xtrace_structured = 0;
+
+/* Each line of xtrace output is assembled here and written all at once. */
+static char *xtrace_buf = (char *)NULL;
+static int xtrace_bufsize = 0;
+static int xtrace_buflen = 0;
+
+/* Flags for xtrace_field */
+#define XT_QUOTE	0x01	/* quote the word if it needs it */
+#define XT_EMPTYQ	0x02	/* print an empty word as '' */
+
 /* shell expansion characters: used in print_redirection_list */
 #define EXPCHAR(c) ((c) == '{' || (c) == '~' || (c) == '$' || (c) == '`')
 
@@ -448,6 +471,12 @@ xtrace_fdchk (fd)
     xtrace_reset ();
 }
 
+/* Characters that cause decode_prompt_string to change a prompt string:
+   backslash escapes, history numbers, and anything promptvars expansion
+   would expand or remove. */
+#define PS4_IS_STATIC(s) \
+	(strpbrk ((s), "\\!$`'\"" ) == 0 && strchr ((s), CTLESC) == 0 && strchr ((s), CTLNUL) == 0)
+
 /* Return a string denoting what our indirection level is. */
 
 char *
@@ -466,10 +495,17 @@ indirection_level_string ()
   if (ps4 == 0 || *ps4 == '\0')
     return (indirection_string);
 
-  old = change_flag ('x', FLAG_OFF);
-  ps4 = decode_prompt_string (ps4);
-  if (old)
-    change_flag ('x', FLAG_ON);
+  /* If there's nothing for decode_prompt_string to expand or remove, which
+     is true of the default value, use PS4 as it is. */
+  if (PS4_IS_STATIC (ps4))
+    ps4 = savestring (ps4);
+  else
+    {
+      old = change_flag ('x', FLAG_OFF);
+      ps4 = decode_prompt_string (ps4);
+      if (old)
+	change_flag ('x', FLAG_ON);
+    }
 
   if (ps4 == 0 || *ps4 == '\0')
     {
@@ -517,20 +553,121 @@ indirection_level_string ()
   return (indirection_string);
 }
 
+/* Start a line of xtrace output.  If XFLAGS is non-zero, begin it with
+   the expansion of $PS4 (or the record header). */
+static void
+xtrace_begin (xflags)
+     int xflags;
+{
+  char *ps4, hdr[128];
+  struct timeval tv;
+
+  CHECK_XTRACE_FP;
+
+  /* Expand PS4 before we start, since that can run arbitrary code. */
+  ps4 = (xflags && xtrace_structured == 0) ? indirection_level_string () : (char *)NULL;
+
+  xtrace_buflen = 0;
+  if (xtrace_structured)
+    {
+      gettimeofday (&tv, NULL);
+      snprintf (hdr, sizeof (hdr), "%ld.%06ld %ld %d ", (long)tv.tv_sec,
+		(long)tv.tv_usec, (long)getpid (), indirection_level);
+      xtrace_add (hdr, strlen (hdr));
+      xtrace_add (get_name_for_error (), -1);
+      snprintf (hdr, sizeof (hdr), ":%d", executing_line_number ());
+      xtrace_add (hdr, strlen (hdr));
+    }
+  else if (ps4)
+    xtrace_add (ps4, -1);
+}
+
+/* Add LEN bytes of S (all of S if LEN < 0) to the current line. */
+static void
+xtrace_add (s, len)
+     const char *s;
+     int len;
+{
+  if (len < 0)
+    len = strlen (s);
+  RESIZE_MALLOCED_BUFFER (xtrace_buf, xtrace_buflen, len + 1, xtrace_bufsize, 128);
+  memcpy (xtrace_buf + xtrace_buflen, s, len);
+  xtrace_buflen += len;
+}
+
+/* Separate two words in the text format; records separate fields anyway. */
+static void
+xtrace_sep ()
+{
+  if (xtrace_structured == 0)
+    xtrace_add (" ", 1);
+}
+
+/* Add the word S to the current line, quoted according to FLAGS if it's
+   text, or as a length-prefixed field if it's a record. */
+static void
+xtrace_field (s, flags)
+     char *s;
+     int flags;
+{
+  char *x, lbuf[INT_STRLEN_BOUND (int) + 3];
+  int len;
+
+  if (s == 0)
+    s = "";
+
+  if (xtrace_structured)
+    {
+      len = strlen (s);
+      snprintf (lbuf, sizeof (lbuf), " %d:", len);
+      xtrace_add (lbuf, strlen (lbuf));
+      xtrace_add (s, len);
+      return;
+    }
+
+  if (*s == '\0')
+    {
+      if (flags & XT_EMPTYQ)
+	xtrace_add ("''", 2);
+    }
+  else if ((flags & XT_QUOTE) && sh_contains_shell_metas (s))
+    {
+      x = sh_single_quote (s);
+      xtrace_add (x, -1);
+      free (x);
+    }
+  else if ((flags & XT_QUOTE) && ansic_shouldquote (s))
+    {
+      x = ansic_quote (s, 0, (int *)0);
+      xtrace_add (x, -1);
+      free (x);
+    }
+  else
+    xtrace_add (s, -1);
+}
+
+/* Finish the current line and write it to the xtrace file. */
+static void
+xtrace_end ()
+{
+  xtrace_add ("\n", 1);
+  fwrite (xtrace_buf, 1, xtrace_buflen, xtrace_fp);
+  fflush (xtrace_fp);
+  xtrace_buflen = 0;
+}
+
 void
 xtrace_print_assignment (name, value, assign_list, xflags)
      char *name, *value;
      int assign_list, xflags;
 {
-  char *nval;
+  char *nval, *t;
+  size_t nlen, vlen;
 
-  CHECK_XTRACE_FP;
-
-  if (xflags)
-    fprintf (xtrace_fp, "%s", indirection_level_string ());
+  xtrace_begin (xflags);
 
   /* VALUE should not be NULL when this is called. */
-  if (*value == '\0' || assign_list)
+  if (xtrace_structured || *value == '\0' || assign_list)
     nval = value;
   else if (sh_contains_shell_metas (value))
     nval = sh_single_quote (value);
@@ -539,15 +676,41 @@ xtrace_print_assignment (name, value, assign_list, xflags)
   else
     nval = value;
 
+  nlen = strlen (name);
+  vlen = strlen (nval);
+  t = xmalloc (nlen + vlen + 4);
+  memcpy (t, name, nlen);
+  t[nlen] = '=';
   if (assign_list)
-    fprintf (xtrace_fp, "%s=(%s)\n", name, nval);
+    {
+      t[nlen+1] = '(';
+      memcpy (t + nlen + 2, nval, vlen);
+      strcpy (t + nlen + vlen + 2, ")");
+    }
   else
-    fprintf (xtrace_fp, "%s=%s\n", name, nval);
+    strcpy (t + nlen + 1, nval);
+  xtrace_field (t, 0);
+  free (t);
 
   if (nval != value)
     FREE (nval);
 
-  fflush (xtrace_fp);
+  xtrace_end ();
+}
+
+static void
+xtrace_words (list, flags)
+     WORD_LIST *list;
+     int flags;
+{
+  WORD_LIST *w;
+
+  for (w = list; w; w = w->next)
+    {
+      xtrace_field (w->word->word, flags);
+      if (w->next)
+	xtrace_sep ();
+    }
 }
 
 /* A function to print the words of a simple command when set -x is on.  Also used to
@@ -559,38 +722,9 @@ xtrace_print_word_list (list, xtflags)
      WORD_LIST *list;
      int xtflags;
 {
-  WORD_LIST *w;
-  char *t, *x;
-
-  CHECK_XTRACE_FP;
-
-  if (xtflags&1)
-    fprintf (xtrace_fp, "%s", indirection_level_string ());
-
-  for (w = list; w; w = w->next)
-    {
-      t = w->word->word;
-      if (t == 0 || *t == '\0')
-	fprintf (xtrace_fp, "''%s", w->next ? " " : "");
-      else if (xtflags & 2)
-	fprintf (xtrace_fp, "%s%s", t, w->next ? " " : "");
-      else if (sh_contains_shell_metas (t))
-	{
-	  x = sh_single_quote (t);
-	  fprintf (xtrace_fp, "%s%s", x, w->next ? " " : "");
-	  free (x);
-	}
-      else if (ansic_shouldquote (t))
-	{
-	  x = ansic_quote (t, 0, (int *)0);
-	  fprintf (xtrace_fp, "%s%s", x, w->next ? " " : "");
-	  free (x);
-	}
-      else
-	fprintf (xtrace_fp, "%s%s", t, w->next ? " " : "");
-    }
-  fprintf (xtrace_fp, "\n");
-  fflush (xtrace_fp);
+  xtrace_begin (xtflags & 1);
+  xtrace_words (list, (xtflags & 2) ? XT_EMPTYQ : (XT_QUOTE|XT_EMPTYQ));
+  xtrace_end ();
 }
 
 static void
@@ -613,10 +747,15 @@ void
 xtrace_print_for_command_head (for_command)
      FOR_COM *for_command;
 {
-  CHECK_XTRACE_FP;
-  fprintf (xtrace_fp, "%s", indirection_level_string ());
-  fprintf (xtrace_fp, "for %s in ", for_command->name->word);
-  xtrace_print_word_list (for_command->map_list, 2);
+  xtrace_begin (1);
+  xtrace_field ("for", 0);
+  xtrace_sep ();
+  xtrace_field (for_command->name->word, 0);
+  xtrace_sep ();
+  xtrace_field ("in", 0);
+  xtrace_sep ();
+  xtrace_words (for_command->map_list, XT_EMPTYQ);
+  xtrace_end ();
 }
 
 static void
@@ -671,10 +810,15 @@ void
 xtrace_print_select_command_head (select_command)
      SELECT_COM *select_command;
 {
-  CHECK_XTRACE_FP;
-  fprintf (xtrace_fp, "%s", indirection_level_string ());
-  fprintf (xtrace_fp, "select %s in ", select_command->name->word);
-  xtrace_print_word_list (select_command->map_list, 2);
+  xtrace_begin (1);
+  xtrace_field ("select", 0);
+  xtrace_sep ();
+  xtrace_field (select_command->name->word, 0);
+  xtrace_sep ();
+  xtrace_field ("in", 0);
+  xtrace_sep ();
+  xtrace_words (select_command->map_list, XT_EMPTYQ);
+  xtrace_end ();
 }
 
 static void
@@ -743,9 +887,13 @@ void
 xtrace_print_case_command_head (case_command)
      CASE_COM *case_command;
 {
-  CHECK_XTRACE_FP;
-  fprintf (xtrace_fp, "%s", indirection_level_string ());
-  fprintf (xtrace_fp, "case %s in\n", case_command->word->word);
+  xtrace_begin (1);
+  xtrace_field ("case", 0);
+  xtrace_sep ();
+  xtrace_field (case_command->word->word, 0);
+  xtrace_sep ();
+  xtrace_field ("in", 0);
+  xtrace_end ();
 }
 
 static void
@@ -943,28 +1091,34 @@ xtrace_print_cond_term (type, invert, op, arg1, arg2)
      WORD_DESC *op;
      char *arg1, *arg2;
 {
-  CHECK_XTRACE_FP;
   command_string_index = 0;
-  fprintf (xtrace_fp, "%s", indirection_level_string ());
-  fprintf (xtrace_fp, "[[ ");
+  xtrace_begin (1);
+  xtrace_field ("[[", 0);
+  xtrace_sep ();
   if (invert)
-    fprintf (xtrace_fp, "! ");
+    {
+      xtrace_field ("!", 0);
+      xtrace_sep ();
+    }
 
   if (type == COND_UNARY)
     {
-      fprintf (xtrace_fp, "%s ", op->word);
-      fprintf (xtrace_fp, "%s", (arg1 && *arg1) ? arg1 : "''");
+      xtrace_field (op->word, 0);
+      xtrace_sep ();
+      xtrace_field (arg1, XT_EMPTYQ);
     }
   else if (type == COND_BINARY)
     {
-      fprintf (xtrace_fp, "%s", (arg1 && *arg1) ? arg1 : "''");
-      fprintf (xtrace_fp, " %s ", op->word);
-      fprintf (xtrace_fp, "%s", (arg2 && *arg2) ? arg2 : "''");
+      xtrace_field (arg1, XT_EMPTYQ);
+      xtrace_sep ();
+      xtrace_field (op->word, 0);
+      xtrace_sep ();
+      xtrace_field (arg2, XT_EMPTYQ);
     }
 
-  fprintf (xtrace_fp, " ]]\n");
-
-  fflush (xtrace_fp);
+  xtrace_sep ();
+  xtrace_field ("]]", 0);
+  xtrace_end ();
 }	  
 #endif /* COND_COMMAND */
 
@@ -974,16 +1128,13 @@ void
 xtrace_print_arith_cmd (list)
      WORD_LIST *list;
 {
-  WORD_LIST *w;
-
-  CHECK_XTRACE_FP;
-  fprintf (xtrace_fp, "%s", indirection_level_string ());
-  fprintf (xtrace_fp, "(( ");
-  for (w = list; w; w = w->next)
-    fprintf (xtrace_fp, "%s%s", w->word->word, w->next ? " " : "");
-  fprintf (xtrace_fp, " ))\n");
-
-  fflush (xtrace_fp);
+  xtrace_begin (1);
+  xtrace_field ("((", 0);
+  xtrace_sep ();
+  xtrace_words (list, 0);
+  xtrace_sep ();
+  xtrace_field ("))", 0);
+  xtrace_end ();
 }
 #endif
 
@@ -2046,6 +2046,7 @@ shell_reinitialize ()
      the environment is parsed. */
   delete_all_contexts (shell_variables);
   delete_all_variables (shell_functions);
+  INVALIDATE_COMMAND_LOOKUPS ();
 
   reinit_special_variables ();
 
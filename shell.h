@@ -163,6 +163,10 @@ extern struct user_info current_user;
 
 #define HEREDOC_MAX 16
 
+/* The number of PIPESTATUS values a parser state snapshot can hold without
+   copying the array. */
+#define PSTATUS_SAVE_MAX 8
+
 /* Structure in which to save partial parsing state when doing things like
    PROMPT_COMMAND and bash_execute_unix_command execution. */
 
@@ -170,7 +174,7 @@ typedef struct _sh_parser_state_t
 {
   /* parsing state */
   int parser_state;
-  int *token_state;
+  int token_state[4];
 
   char *token;
   size_t token_buffer_size;
@@ -197,7 +201,9 @@ typedef struct _sh_parser_state_t
   /* execution state possibly modified by the parser */
   int last_command_exit_value;
 #if defined (ARRAY_VARS)
-  ARRAY *pipestatus;
+  ARRAY *pipestatus;		/* used only if npipestatus == -1 */
+  int npipestatus;
+  int pipestatus_vals[PSTATUS_SAVE_MAX];
 #endif
   sh_builtin_func_t *last_shell_builtin, *this_shell_builtin;
 
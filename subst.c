@@ -272,6 +272,9 @@ static char *extract_heredoc_dolbrace_string PARAMS((char *, int *, int, int));
 static char *extract_dollar_brace_string PARAMS((char *, int *, int, int));
 static int skip_matched_pair PARAMS((const char *, int, int, int, int));
 
+static int comsub_bound_lookup PARAMS((char *));
+static void comsub_bound_add PARAMS((char *, int));
+
 static char *pos_params PARAMS((char *, int, int, int, int));
 
 static unsigned char *mb_getcharlens PARAMS((char *, int));
@@ -368,6 +371,7 @@ static int make_internal_declare PARAMS((char *, char *, char *));
 static void expand_compound_assignment_word PARAMS((WORD_LIST *, int));
 static WORD_LIST *expand_declaration_argument PARAMS((WORD_LIST *, WORD_LIST *));
 #endif
+static int plain_word_p PARAMS((WORD_DESC *));
 static WORD_LIST *shell_expand_word_list PARAMS((WORD_LIST *, int));
 static WORD_LIST *expand_word_list_internal PARAMS((WORD_LIST *, int));
 
@@ -1286,8 +1290,20 @@ extract_command_subst (string, sindex, xflags)
     return (extract_delimited_string (string, sindex, "$(", "(", ")", xflags|SX_COMMAND)); /*)*/
   else
     {
+      int start, len;
+
+      /* If we've seen this text before, we know where it ends */
+      start = *sindex;
+      if ((len = comsub_bound_lookup (string+start)) >= 0)
+	{
+	  *sindex = start + len;
+	  return ((xflags & SX_NOALLOC) ? (char *)NULL : substring (string, start, start + len));
+	}
+
       xflags |= (no_longjmp_on_fatal_error ? SX_NOLONGJMP : 0);
       ret = xparse_dolparen (string, string+*sindex, sindex, xflags);
+      if ((xflags & SX_NOLONGJMP) == 0 && string[*sindex] == RPAREN && *sindex >= start)
+	comsub_bound_add (string+start, *sindex - start);
       return ret;
     }
 }
@@ -3720,6 +3736,72 @@ list_rest_of_args ()
   return (REVERSE_LIST (list, WORD_LIST *));
 }
 
+/* An array of pointers into rest_of_args, built the first time we need to
+   find a positional parameter past $9, so that ${N} and ${@:N} don't walk
+   the list.  posparam_index[posparam_index_off] is the current head of
+   rest_of_args; `shift' just bumps the offset.  Anything else that changes
+   rest_of_args calls invalidate_posparam_index(). */
+static WORD_LIST **posparam_index = 0;
+static int posparam_index_size = 0;
+static int posparam_index_len = -1;		/* -1 means invalid */
+static int posparam_index_off = 0;
+
+void
+invalidate_posparam_index ()
+{
+  posparam_index_len = -1;
+  posparam_index_off = 0;
+}
+
+/* The first N elements of rest_of_args have been removed by `shift'. */
+void
+shift_posparam_index (n)
+     int n;
+{
+  if (posparam_index_len < 0)
+    return;
+  posparam_index_off += n;
+  if (posparam_index_off > posparam_index_len)
+    invalidate_posparam_index ();
+}
+
+/* Return the element of rest_of_args holding positional parameter IND + 10,
+   or NULL if there aren't that many. */
+static WORD_LIST *
+rest_of_args_nth (ind)
+     intmax_t ind;
+{
+  WORD_LIST *p;
+  int n;
+
+  if (rest_of_args == 0 || ind < 0)
+    return ((WORD_LIST *)NULL);
+
+  /* Sanity check: the index should always be invalidated when rest_of_args
+     changes, but rebuilding it is cheap insurance. */
+  if (posparam_index_len >= 0 &&
+	(posparam_index_off == posparam_index_len || posparam_index[posparam_index_off] != rest_of_args))
+    invalidate_posparam_index ();
+
+  if (posparam_index_len < 0)
+    {
+      n = list_length (rest_of_args);
+      if (n >= posparam_index_size)
+	{
+	  posparam_index_size = (n + 16) & ~15;
+	  posparam_index = (WORD_LIST **)xrealloc (posparam_index, posparam_index_size * sizeof (WORD_LIST *));
+	}
+      for (n = 0, p = rest_of_args; p; p = p->next)
+	posparam_index[n++] = p;
+      posparam_index_len = n;
+      posparam_index_off = 0;
+    }
+
+  if (ind >= posparam_index_len - posparam_index_off)
+    return ((WORD_LIST *)NULL);
+  return (posparam_index[posparam_index_off + ind]);
+}
+
 /* Return the value of a positional parameter.  This handles values > 10. */
 char *
 get_dollar_var_value (ind)
@@ -3732,9 +3814,7 @@ get_dollar_var_value (ind)
     temp = dollar_vars[ind] ? savestring (dollar_vars[ind]) : (char *)NULL;
   else	/* We want something like ${11} */
     {
-      ind -= 10;
-      for (p = rest_of_args; p && ind--; p = p->next)
-	;
+      p = rest_of_args_nth (ind - 10);
       temp = p ? savestring (p->word->word) : (char *)NULL;
     }
   return (temp);
@@ -3766,7 +3846,7 @@ pos_params (string, start, end, quoted, pflags)
      char *string;
      int start, end, quoted, pflags;
 {
-  WORD_LIST *save, *params, *h, *t;
+  WORD_LIST *list, *p;
   char *ret;
   int i;
 
@@ -3774,36 +3854,29 @@ pos_params (string, start, end, quoted, pflags)
   if (start == end)
     return ((char *)NULL);
 
-  save = params = list_rest_of_args ();
-  if (save == 0 && start > 0)
-    return ((char *)NULL);
-
-  if (start == 0)		/* handle ${@:0[:x]} specially */
+  /* Build a list of just the parameters we want instead of copying all of
+     them and throwing most away. */
+  list = (WORD_LIST *)NULL;
+  i = start;
+  if (i == 0)		/* handle ${@:0[:x]} specially */
     {
-      t = make_word_list (make_word (dollar_vars[0]), params);
-      save = params = t;
+      list = make_word_list (make_word (dollar_vars[0]), list);
+      i++;
     }
 
-  for (i = start ? 1 : 0; params && i < start; i++)
-    params = params->next;
-  if (params == 0)
-    {
-      dispose_words (save);
-      return ((char *)NULL);
-    }
-  for (h = t = params; params && i < end; i++)
-    {
-      t = params;
-      params = params->next;
-    }
-  t->next = (WORD_LIST *)NULL;
+  for ( ; i < end && i < 10 && dollar_vars[i]; i++)
+    list = make_word_list (make_bare_word (dollar_vars[i]), list);
+
+  for (p = (i >= 10) ? rest_of_args_nth (i - 10) : rest_of_args; p && i < end; p = p->next, i++)
+    list = make_word_list (make_bare_word (p->word->word), list);
 
-  ret = string_list_pos_params (string[0], h, quoted, pflags);
+  if (list == 0)
+    return ((char *)NULL);
 
-  if (t != params)
-    t->next = params;
+  list = REVERSE_LIST (list, WORD_LIST *);
+  ret = string_list_pos_params (string[0], list, quoted, pflags);
 
-  dispose_words (save);
+  dispose_words (list);
   return (ret);
 }
 
@@ -4101,6 +4174,61 @@ remove_backslashes (string)
   return ret;
 }
 
+/* If W is a reference to a set scalar variable, $name or "$name", store the
+   result of expanding it as cond_expand_word would in *RP and return 1.
+   Return 0 if W is anything else and needs to go through the full expansion
+   machinery. */
+static int
+cond_simple_varref (w, special, rp)
+     WORD_DESC *w;
+     int special;
+     char **rp;
+{
+  char *s, *value, *t, name[64];
+  int quoted, len, qflags;
+  SHELL_VAR *var;
+
+  s = w->word;
+  quoted = (*s == '"');
+  if (quoted)
+    s++;
+  if (*s++ != '$' || legal_variable_starter (*s) == 0)
+    return 0;
+  for (len = 1; legal_variable_char (s[len]); len++)
+    ;
+  if (quoted ? (s[len] != '"' || s[len+1]) : s[len])
+    return 0;
+  if (len >= sizeof (name))
+    return 0;
+  memcpy (name, s, len);
+  name[len] = '\0';
+
+  var = find_variable (name);
+  if (var == 0 || invisible_p (var) || var_isset (var) == 0)
+    return 0;
+#if defined (ARRAY_VARS)
+  if (array_p (var) || assoc_p (var))
+    return 0;
+#endif
+
+  value = value_cell (var);
+  if (*value == 0)
+    *rp = quoted ? savestring ("") : (char *)NULL;
+  else if (special == 1 || special == 2)
+    {
+      qflags = QGLOB_CVTNULL|QGLOB_CTLESC;
+      if (special == 2)
+	qflags |= QGLOB_REGEXP;
+      t = quoted ? quote_string (value) : quote_escapes (value);
+      *rp = quote_string_for_globbing (t, qflags);
+      free (t);
+    }
+  else
+    *rp = savestring (value);
+
+  return 1;
+}
+
 /* This needs better error handling. */
 /* Expand W for use as an argument to a unary or binary operator in a
    [[...]] expression.  If SPECIAL is 1, this is the rhs argument
@@ -4125,6 +4253,10 @@ cond_expand_word (w, special)
   if (w->word == 0 || w->word[0] == '\0')
     return ((char *)NULL);
 
+  /* Simple variable references are common enough to be worth a shortcut */
+  if ((w->flags & W_HASDOLLAR) && cond_simple_varref (w, special, &r))
+    return r;
+
   expand_no_split_dollar_star = 1;
   w->flags |= W_NOSPLIT2;
   qflags = (special == 3) ? Q_ARITH : 0;
@@ -4971,6 +5103,8 @@ dequote_list (list)
 
   for (tlist = list; tlist; tlist = tlist->next)
     {
+      if (QUOTED_NULL (tlist->word->word) == 0 && strchr (tlist->word->word, CTLESC) == 0)
+	continue;
       s = dequote_string (tlist->word->word);
       if (QUOTED_NULL (tlist->word->word))
 	tlist->word->flags &= ~W_HASQUOTEDNULL;
@@ -5945,6 +6079,232 @@ parameter_brace_remove_pattern (varname, value, estatep, patstr, rtype, quoted,
   return temp1;
 }    
 
+/*****************************************************************/
+/*								 */
+/*	    Caching Parsed Command and Process Substitutions	 */
+/*								 */
+/*****************************************************************/
+
+/* Each time a command or process substitution is expanded, the parent
+   shell parses the text to find where it ends (xparse_dolparen) and the
+   child parses it again to run it.  In loops that's the same text every
+   time, so we remember both results.  COMSUB_BOUNDS holds the text of each
+   command substitution we've found the end of, keyed by its first few
+   characters (see comsub_bound_key); COMSUB_TREES maps the text of a command
+   or process substitution to its parsed form, which the child runs
+   directly.  Both depend on the parser options in effect, so we record
+   those and reparse if they change.  Neither table is allowed to grow
+   without bound. */
+
+#define COMSUB_CACHE_BUCKETS	64
+#define COMSUB_CACHE_MAX	256
+
+#define COMSUB_BOUND_KEYLEN	32	/* most characters hashed for a key */
+#define COMSUB_BOUND_CHAIN	4	/* most substitutions sharing a key */
+
+#define COMSUB_PARSE_STAMP() \
+	((posixly_correct != 0) | ((extended_glob != 0) << 1) | \
+	 ((interactive_comments != 0) << 2) | (shell_compatibility_level << 3))
+
+typedef struct comsub_tree {
+  COMMAND *command;
+  int line;
+  int stamp;
+} COMSUB_TREE;
+
+typedef struct comsub_bound {
+  struct comsub_bound *next;	/* others with the same key */
+  char *text;			/* the text between `$(' and `)' */
+  int len;
+  int stamp;
+} COMSUB_BOUND;
+
+static HASH_TABLE *comsub_trees = (HASH_TABLE *)NULL;
+static HASH_TABLE *comsub_bounds = (HASH_TABLE *)NULL;
+
+static void
+dispose_comsub_tree (data)
+     PTR_T data;
+{
+  COMSUB_TREE *ct;
+
+  ct = (COMSUB_TREE *)data;
+  if (ct->command)
+    dispose_command (ct->command);
+  free (ct);
+}
+
+/* Return the parsed form of STRING, a command or process substitution the
+   caller is about to run with parse_and_execute using flags PFLAGS, parsing
+   and caching it if necessary.  EXPALIASES is non-zero if that parse would
+   expand aliases, which we don't cache.  The child process takes ownership
+   of the returned command and must call comsub_tree_release. */
+static COMSUB_TREE *
+comsub_tree_lookup (string, pflags, expaliases)
+     char *string;
+     int pflags, expaliases;
+{
+  BUCKET_CONTENTS *b;
+  COMSUB_TREE *ct;
+  COMMAND *cmd;
+  int stamp, oline;
+
+  if (expaliases || strchr (string, CTLESC))
+    return ((COMSUB_TREE *)NULL);
+
+  stamp = COMSUB_PARSE_STAMP ();
+  if (comsub_trees == 0)
+    comsub_trees = hash_create (COMSUB_CACHE_BUCKETS);
+
+  b = hash_search (string, comsub_trees, 0);
+  ct = b ? (COMSUB_TREE *)b->data : (COMSUB_TREE *)NULL;
+  if (ct && ct->command && ct->line == line_number && ct->stamp == stamp)
+    return ct;
+
+  /* Parse the way parse_and_execute would, so line numbers agree */
+  oline = line_number;
+  line_number = (pflags & SEVAL_RESETLINE) ? 0 : line_number - 1;
+  cmd = parse_string_to_command (string, SX_NOLONGJMP|SX_COMPLETE);
+  line_number = oline;
+
+  if (cmd == 0)
+    return ((COMSUB_TREE *)NULL);
+
+  if (ct == 0)
+    {
+      if (HASH_ENTRIES (comsub_trees) >= COMSUB_CACHE_MAX)
+	hash_flush (comsub_trees, dispose_comsub_tree);
+      b = hash_insert (savestring (string), comsub_trees, HASH_NOSRCH);
+      ct = (COMSUB_TREE *)xmalloc (sizeof (COMSUB_TREE));
+      b->data = (PTR_T)ct;
+    }
+  else if (ct->command)
+    dispose_command (ct->command);
+
+  ct->command = cmd;
+  ct->line = oline;
+  ct->stamp = stamp;
+
+  return ct;
+}
+
+/* Called in the child: detach the cached command so parse_and_execute can
+   dispose it when it's done. */
+static COMMAND *
+comsub_tree_release (ct)
+     COMSUB_TREE *ct;
+{
+  COMMAND *cmd;
+
+  if (ct == 0)
+    return ((COMMAND *)NULL);
+  cmd = ct->command;
+  ct->command = (COMMAND *)NULL;
+  return cmd;
+}
+
+static void
+dispose_comsub_bounds (data)
+     PTR_T data;
+{
+  COMSUB_BOUND *cb, *next;
+
+  for (cb = (COMSUB_BOUND *)data; cb; cb = next)
+    {
+      next = cb->next;
+      free (cb->text);
+      free (cb);
+    }
+}
+
+/* Copy the key for the command substitution at the start of STRING, which
+   follows `$(', into KEY: its first COMSUB_BOUND_KEYLEN characters, or
+   fewer if there's a close paren before that.  The first close paren can't
+   come after the one that ends the command substitution, so the key
+   depends only on the command substitution's text, not on what follows it,
+   and building it doesn't look at the rest of STRING. */
+static void
+comsub_bound_key (string, key)
+     char *string, *key;
+{
+  int i;
+
+  for (i = 0; i < COMSUB_BOUND_KEYLEN && string[i]; i++)
+    if ((key[i] = string[i]) == RPAREN)
+      {
+	i++;
+	break;
+      }
+  key[i] = '\0';
+}
+
+/* Return the number of characters of STRING, which follows `$(', that
+   make up the command substitution, or -1 if we haven't seen it before. */
+static int
+comsub_bound_lookup (string)
+     char *string;
+{
+  BUCKET_CONTENTS *b;
+  COMSUB_BOUND *cb;
+  char key[COMSUB_BOUND_KEYLEN + 1];
+  int stamp;
+
+  if (comsub_bounds == 0)
+    return -1;
+  comsub_bound_key (string, key);
+  b = hash_search (key, comsub_bounds, 0);
+  stamp = COMSUB_PARSE_STAMP ();
+  for (cb = b ? (COMSUB_BOUND *)b->data : (COMSUB_BOUND *)NULL; cb; cb = cb->next)
+    if (cb->stamp == stamp && STREQN (cb->text, string, cb->len) && string[cb->len] == RPAREN)
+      return (cb->len);
+  return -1;
+}
+
+/* Remember that the first LEN characters of STRING, which follows `$(', are
+   a command substitution ending at STRING[LEN]. */
+static void
+comsub_bound_add (string, len)
+     char *string;
+     int len;
+{
+  BUCKET_CONTENTS *b;
+  COMSUB_BOUND *cb, *prev;
+  char key[COMSUB_BOUND_KEYLEN + 1];
+  int n;
+
+  if (comsub_bounds == 0)
+    comsub_bounds = hash_create (COMSUB_CACHE_BUCKETS);
+  comsub_bound_key (string, key);
+  b = hash_search (key, comsub_bounds, 0);
+  if (b == 0)
+    {
+      if (HASH_ENTRIES (comsub_bounds) >= COMSUB_CACHE_MAX)
+	hash_flush (comsub_bounds, dispose_comsub_bounds);
+      b = hash_insert (savestring (key), comsub_bounds, HASH_NOSRCH);
+      b->data = (PTR_T)NULL;
+    }
+
+  for (cb = (COMSUB_BOUND *)b->data; cb; cb = cb->next)
+    if (cb->len == len && STREQN (cb->text, string, len))
+      {
+	cb->stamp = COMSUB_PARSE_STAMP ();
+	return;
+      }
+
+  cb = (COMSUB_BOUND *)xmalloc (sizeof (COMSUB_BOUND));
+  cb->text = substring (string, 0, len);
+  cb->len = len;
+  cb->stamp = COMSUB_PARSE_STAMP ();
+  cb->next = (COMSUB_BOUND *)b->data;
+  b->data = (PTR_T)cb;
+
+  /* Forget the oldest ones with this key if there are too many */
+  for (n = 1, prev = cb; prev->next && n < COMSUB_BOUND_CHAIN; n++)
+    prev = prev->next;
+  dispose_comsub_bounds ((PTR_T)prev->next);
+  prev->next = (COMSUB_BOUND *)NULL;
+}
+
 #if defined (PROCESS_SUBSTITUTION)
 
 static void reap_some_procsubs PARAMS((int));
@@ -6488,6 +6848,7 @@ process_substitute (string, open_for_read_in_child)
   char *pathname;
   int fd, result, rc, function_value;
   pid_t old_pid, pid;
+  COMSUB_TREE *ct;
 #if defined (HAVE_DEV_FD)
   int parent_pipe_fd, child_pipe_fd;
   int fildes[2];
@@ -6533,6 +6894,8 @@ process_substitute (string, open_for_read_in_child)
   save_pipeline (1);
 #endif /* JOB_CONTROL */
 
+  ct = comsub_tree_lookup (string, 0, expand_aliases);
+
   pid = make_child ((char *)NULL, FORK_ASYNC);
   if (pid == 0)
     {
@@ -6738,7 +7101,10 @@ process_substitute (string, open_for_read_in_child)
   else
     {
       subshell_level++;
-      rc = parse_and_execute (string, "process substitution", (SEVAL_NONINT|SEVAL_NOHIST));
+      if (ct && ct->command)
+	rc = execute_parsed_string (string, comsub_tree_release (ct), "process substitution", (SEVAL_NONINT|SEVAL_NOHIST));
+      else
+	rc = parse_and_execute (string, "process substitution", (SEVAL_NONINT|SEVAL_NOHIST));
       /* leave subshell level intact for any exit trap */
     }
 
@@ -6925,6 +7291,7 @@ command_substitute (string, quoted, flags)
   char *istring, *s;
   int result, fildes[2], function_value, pflags, rc, tflag, fork_flags;
   WORD_DESC *ret;
+  COMSUB_TREE *ct;
   sigset_t set, oset;
 
   istring = (char *)NULL;
@@ -6985,6 +7352,11 @@ command_substitute (string, quoted, flags)
   /* Flags to pass to parse_and_execute() */
   pflags = (interactive && sourcelevel == 0) ? SEVAL_RESETLINE : 0;
 
+  /* The child expands aliases while parsing $(...) unless in posix mode;
+     see below */
+  ct = comsub_tree_lookup (string, pflags,
+			   expand_aliases && ((flags & PF_BACKQUOTE) || posixly_correct == 0));
+
   old_pid = last_made_pid;
 
   /* Pipe the output of executing STRING into the current shell. */
@@ -7161,7 +7533,10 @@ command_substitute (string, quoted, flags)
       else
 	{
 	  subshell_level++;
-	  rc = parse_and_execute (string, "command substitution", pflags|SEVAL_NOHIST);
+	  if (ct && ct->command)
+	    rc = execute_parsed_string (string, comsub_tree_release (ct), "command substitution", pflags|SEVAL_NOHIST);
+	  else
+	    rc = parse_and_execute (string, "command substitution", pflags|SEVAL_NOHIST);
 	  /* leave subshell level intact for any exit trap */
 	}
 
@@ -8760,7 +9135,7 @@ mb_substring (string, s, e)
      int s, e;
 {
   char *tt;
-  int start, stop, i;
+  int start, stop, i, alen;
   size_t slen;
   DECLARE_MBSTATE;
 
@@ -8768,13 +9143,23 @@ mb_substring (string, s, e)
   /* Don't need string length in ADVANCE_CHAR unless multibyte chars possible. */
   slen = (MB_CUR_MAX > 1) ? STRLEN (string) : 0;
 
-  i = s;
+  /* In UTF-8, character and byte offsets are the same in an ASCII prefix;
+     if that's the whole string, we don't need to step through it. */
+  alen = locale_utf8locale ? mbsasciilen (string, slen) : 0;
+
+  start = (s < alen) ? s : alen;
+  i = s - start;
   while (string[start] && i--)
     ADVANCE_CHAR (string, slen, start);
-  stop = start;
-  i = e - s;
-  while (string[stop] && i--)
-    ADVANCE_CHAR (string, slen, stop);
+  if (e >= s && start + (e - s) <= alen)
+    stop = start + (e - s);
+  else
+    {
+      stop = start;
+      i = e - s;
+      while (string[stop] && i--)
+	ADVANCE_CHAR (string, slen, stop);
+    }
   tt = substring (string, start, stop);
   return tt;
 }
@@ -9839,6 +10224,11 @@ parameter_brace_expand (string, indexp, quoted, pflags, quoted_dollar_atp, conta
       if (contains_dollar_at && *contains_dollar_at)
 	all_element_arrayref = 1;
     }
+  else if (want_substring && STR_DOLLAR_AT_STAR (name))
+    /* parameter_brace_substring and pos_params fetch just the positional
+       parameters they need; don't expand all of them here only to throw
+       the result away. */
+    tdesc = (WORD_DESC *)NULL;
   else
     {
       local_pflags |= PF_IGNUNBOUND|(pflags&(PF_NOSPLIT2|PF_ASSIGNRHS));
@@ -12386,10 +12776,13 @@ glob_expand_word_list (tlist, eflags)
 	}
       else
 	{
-	  /* Dequote the string. */
-	  temp_string = dequote_string (tlist->word->word);
-	  free (tlist->word->word);
-	  tlist->word->word = temp_string;
+	  /* Dequote the string, if there's anything to remove. */
+	  if (QUOTED_NULL (tlist->word->word) || strchr (tlist->word->word, CTLESC))
+	    {
+	      temp_string = dequote_string (tlist->word->word);
+	      free (tlist->word->word);
+	      tlist->word->word = temp_string;
+	    }
 	  PREPEND_LIST (tlist, output_list);
 	}
 
@@ -12787,16 +13180,53 @@ expand_declaration_argument (tlist, wcmd)
 }
 #endif /* ARRAY_VARS */
 
+/* Return 1 if WORD would come out of expand_word_internal unchanged: it
+   contains no quoting, no expansions, no characters in $IFS, and none of
+   the characters that need special handling in assignments or process
+   substitution.  Filename generation is still performed on it later. */
+static int
+plain_word_p (word)
+     WORD_DESC *word;
+{
+  register char *s;
+
+  if (word->flags & (W_QUOTED|W_HASDOLLAR|W_ASSIGNARG|W_ASSIGNRHS|W_COMPASSIGN|W_HASQUOTEDNULL))
+    return 0;
+
+  for (s = word->word; *s; s++)
+    switch (*s)
+      {
+      case CTLESC:
+      case CTLNUL:
+      case '<':
+      case '>':
+      case '~':
+      case '$':
+      case '`':
+      case '\\':
+      case '"':
+      case '\'':
+      case ' ':
+	return 0;
+      default:
+	if (isifs (*s))
+	  return 0;
+	break;
+      }
+
+  return (s != word->word);
+}
+
 static WORD_LIST *
 shell_expand_word_list (tlist, eflags)
      WORD_LIST *tlist;
      int eflags;
 {
-  WORD_LIST *expanded, *orig_list, *new_list, *next, *temp_list, *wcmd;
+  WORD_LIST *expanded, *orig_list, *new_list, *next, *temp_list, *wcmd, *prev;
   int expanded_something, has_dollar_at;
 
   /* We do tilde expansion all the time.  This is what 1003.2 says. */
-  wcmd = new_list = (WORD_LIST *)NULL;
+  wcmd = new_list = prev = (WORD_LIST *)NULL;
 
   for (orig_list = tlist; tlist; tlist = next)
     {
@@ -12805,6 +13235,22 @@ shell_expand_word_list (tlist, eflags)
 	
       next = tlist->next;
 
+      /* If expanding the word would just make a copy of it, move it from
+	 our copy of the original list to the new list instead.  We don't
+	 do this for the arguments to declaration commands, since
+	 expand_declaration_argument walks the original list. */
+      if (wcmd == 0 && plain_word_p (tlist->word))
+	{
+	  tlist->word->flags &= (W_ASSIGNMENT|W_NOGLOB|W_NOBRACE|W_ARRAYREF);
+	  if (prev)
+	    prev->next = next;
+	  else
+	    orig_list = next;
+	  tlist->next = new_list;
+	  new_list = tlist;
+	  continue;
+	}
+
 #if defined (ARRAY_VARS)
       /* If this is a compound array assignment to a builtin that accepts
          such assignments (e.g., `declare'), take the assignment and perform
@@ -12856,6 +13302,7 @@ shell_expand_word_list (tlist, eflags)
 
       expanded = REVERSE_LIST (temp_list, WORD_LIST *);
       new_list = (WORD_LIST *)list_append (expanded, new_list);
+      prev = tlist;
     }
 
   if (orig_list)  
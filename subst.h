@@ -155,6 +155,11 @@ extern char *sub_append_number PARAMS((intmax_t, char *, int *, int *));
 /* Return the word list that corresponds to `$*'. */
 extern WORD_LIST *list_rest_of_args PARAMS((void));
 
+/* Tell the code that indexes the positional parameters that rest_of_args
+   has been changed or had N elements shifted off its front. */
+extern void invalidate_posparam_index PARAMS((void));
+extern void shift_posparam_index PARAMS((int));
+
 /* Make a single large string out of the dollar digit variables,
    and the rest_of_args.  If DOLLAR_STAR is 1, then obey the special
    case of "$*" with respect to IFS. */
@@ -105,6 +105,22 @@ static int test_error_return;
 
 extern int sh_stat PARAMS((const char *, struct stat *));
 
+/* If non-zero, the file tests in a single test, [, or [[ command remember
+   the result of the last stat and use it for later tests of the same file. */
+int test_statcache = 0;
+
+static int statcache_active;
+static char *statcache_file = (char *)NULL;
+static struct stat statcache_buf;
+static int statcache_errno;	/* errno if the stat failed, else 0 */
+
+static int test_stat PARAMS((char *, struct stat *));
+
+/* The precompiled form of the test or [ command that execute_simple_command
+   is about to run, if it has one.  test_command uses it once, and only if
+   the expanded arguments still have the shape it was compiled for. */
+TEST_COMPILED test_compiled;
+
 static int pos;		/* The offset of the current argument in ARGV. */
 static int argc;	/* The number of arguments present in ARGV. */
 static char **argv;	/* The argument list. */
@@ -120,12 +136,19 @@ static int two_arguments PARAMS((void));
 static int three_arguments PARAMS((void));
 static int posixtest PARAMS((void));
 
+static int test_word_onefield PARAMS((WORD_DESC *));
+static int test_word_literal PARAMS((WORD_DESC *, char *));
+static char *test_word_operator PARAMS((WORD_DESC *));
+static int test_compile_binop PARAMS((TEST_COMPILED *, char *));
+static int test_compiled_eval PARAMS((TEST_COMPILED *));
+
 static int expr PARAMS((void));
 static int term PARAMS((void));
 static int and PARAMS((void));
 static int or PARAMS((void));
 
 static int filecomp PARAMS((char *, char *, int));
+static int arith_decimal PARAMS((char *, intmax_t *));
 static int arithcomp PARAMS((char *, char *, int, int));
 static int patcomp PARAMS((char *, char *, int));
 
@@ -287,6 +310,55 @@ term ()
   return (value);
 }
 
+/* Called at the start and end of each test and [[ command to set up and
+   discard the stat cache. */
+void
+test_statcache_begin ()
+{
+  FREE (statcache_file);
+  statcache_file = (char *)NULL;
+  statcache_active = test_statcache;
+}
+
+void
+test_statcache_end ()
+{
+  FREE (statcache_file);
+  statcache_file = (char *)NULL;
+  statcache_active = 0;
+}
+
+/* sh_stat, using the stat cache if it's active */
+static int
+test_stat (fn, st)
+     char *fn;
+     struct stat *st;
+{
+  int r;
+
+  if (statcache_active == 0)
+    return (sh_stat (fn, st));
+
+  if (statcache_file && STREQ (fn, statcache_file))
+    {
+      if (statcache_errno)
+	{
+	  errno = statcache_errno;
+	  return -1;
+	}
+      *st = statcache_buf;
+      return 0;
+    }
+
+  r = sh_stat (fn, st);
+  FREE (statcache_file);
+  statcache_file = savestring (fn);
+  statcache_errno = (r < 0) ? errno : 0;
+  if (r == 0)
+    statcache_buf = *st;
+  return r;
+}
+
 static int
 stat_mtime (fn, st, ts)
      char *fn;
@@ -295,7 +367,7 @@ stat_mtime (fn, st, ts)
 {
   int r;
 
-  r = sh_stat (fn, st);
+  r = test_stat (fn, st);
   if (r < 0)
     return r;
   *ts = get_stat_mtime (st);
@@ -331,6 +403,38 @@ filecomp (s, t, op)
   return (FALSE);
 }
 
+/* Return 1 and store its value in *IP if S is an optionally-negative decimal
+   integer, without leading zeros, small enough that evaluating it as an
+   arithmetic expression can't overflow.  Those are the arguments to the
+   [[ arithmetic operators that don't need to go through evalexp. */
+static int
+arith_decimal (s, ip)
+     char *s;
+     intmax_t *ip;
+{
+  intmax_t v;
+  int n, neg;
+
+  neg = (*s == '-');
+  if (neg)
+    s++;
+  if (s[0] == '0' && s[1] == '\0')
+    {
+      *ip = 0;
+      return 1;
+    }
+  for (n = 0, v = 0; DIGIT (s[n]); n++)
+    {
+      if (n == 18 || (n == 0 && s[n] == '0'))
+	return 0;
+      v = v * 10 + TODIGIT (s[n]);
+    }
+  if (n == 0 || s[n])
+    return 0;
+  *ip = neg ? -v : v;
+  return 1;
+}
+
 static int
 arithcomp (s, t, op, flags)
      char *s, *t;
@@ -344,12 +448,18 @@ arithcomp (s, t, op, flags)
       int eflag;
 
       eflag = (shell_compatibility_level > 51) ? 0 : EXP_EXPANDED;
-      l = evalexp (s, eflag, &expok);
-      if (expok == 0)
-	return (FALSE);		/* should probably longjmp here */
-      r = evalexp (t, eflag, &expok);
-      if (expok == 0)
-	return (FALSE);		/* ditto */
+      if (arith_decimal (s, &l) == 0)
+	{
+	  l = evalexp (s, eflag, &expok);
+	  if (expok == 0)
+	    return (FALSE);	/* should probably longjmp here */
+	}
+      if (arith_decimal (t, &r) == 0)
+	{
+	  r = evalexp (t, eflag, &expok);
+	  if (expok == 0)
+	    return (FALSE);	/* ditto */
+	}
     }
   else
     {
@@ -527,7 +637,7 @@ unary_test (op, arg, flags)
     {
     case 'a':			/* file exists in the file system? */
     case 'e':
-      return (sh_stat (arg, &stat_buf) == 0);
+      return (test_stat (arg, &stat_buf) == 0);
 
     case 'r':			/* file is readable? */
       return (sh_eaccess (arg, R_OK) == 0);
@@ -539,22 +649,22 @@ unary_test (op, arg, flags)
       return (sh_eaccess (arg, X_OK) == 0);
 
     case 'O':			/* File is owned by you? */
-      return (sh_stat (arg, &stat_buf) == 0 &&
+      return (test_stat (arg, &stat_buf) == 0 &&
 	      (uid_t) current_user.euid == (uid_t) stat_buf.st_uid);
 
     case 'G':			/* File is owned by your group? */
-      return (sh_stat (arg, &stat_buf) == 0 &&
+      return (test_stat (arg, &stat_buf) == 0 &&
 	      (gid_t) current_user.egid == (gid_t) stat_buf.st_gid);
 
     case 'N':
-      if (sh_stat (arg, &stat_buf) < 0)
+      if (test_stat (arg, &stat_buf) < 0)
 	return (FALSE);
       atime = get_stat_atime (&stat_buf);
       mtime = get_stat_mtime (&stat_buf);
       return (timespec_cmp (mtime, atime) > 0);
 
     case 'f':			/* File is a file? */
-      if (sh_stat (arg, &stat_buf) < 0)
+      if (test_stat (arg, &stat_buf) < 0)
 	return (FALSE);
 
       /* -f is true if the given file exists and is a regular file. */
@@ -565,29 +675,29 @@ unary_test (op, arg, flags)
 #endif /* !S_IFMT */
 
     case 'd':			/* File is a directory? */
-      return (sh_stat (arg, &stat_buf) == 0 && (S_ISDIR (stat_buf.st_mode)));
+      return (test_stat (arg, &stat_buf) == 0 && (S_ISDIR (stat_buf.st_mode)));
 
     case 's':			/* File has something in it? */
-      return (sh_stat (arg, &stat_buf) == 0 && stat_buf.st_size > (off_t) 0);
+      return (test_stat (arg, &stat_buf) == 0 && stat_buf.st_size > (off_t) 0);
 
     case 'S':			/* File is a socket? */
 #if !defined (S_ISSOCK)
       return (FALSE);
 #else
-      return (sh_stat (arg, &stat_buf) == 0 && S_ISSOCK (stat_buf.st_mode));
+      return (test_stat (arg, &stat_buf) == 0 && S_ISSOCK (stat_buf.st_mode));
 #endif /* S_ISSOCK */
 
     case 'c':			/* File is character special? */
-      return (sh_stat (arg, &stat_buf) == 0 && S_ISCHR (stat_buf.st_mode));
+      return (test_stat (arg, &stat_buf) == 0 && S_ISCHR (stat_buf.st_mode));
 
     case 'b':			/* File is block special? */
-      return (sh_stat (arg, &stat_buf) == 0 && S_ISBLK (stat_buf.st_mode));
+      return (test_stat (arg, &stat_buf) == 0 && S_ISBLK (stat_buf.st_mode));
 
     case 'p':			/* File is a named pipe? */
 #ifndef S_ISFIFO
       return (FALSE);
 #else
-      return (sh_stat (arg, &stat_buf) == 0 && S_ISFIFO (stat_buf.st_mode));
+      return (test_stat (arg, &stat_buf) == 0 && S_ISFIFO (stat_buf.st_mode));
 #endif /* S_ISFIFO */
 
     case 'L':			/* Same as -h  */
@@ -600,17 +710,17 @@ unary_test (op, arg, flags)
 #endif /* S_IFLNK && HAVE_LSTAT */
 
     case 'u':			/* File is setuid? */
-      return (sh_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISUID) != 0);
+      return (test_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISUID) != 0);
 
     case 'g':			/* File is setgid? */
-      return (sh_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISGID) != 0);
+      return (test_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISGID) != 0);
 
     case 'k':			/* File has sticky bit set? */
 #if !defined (S_ISVTX)
       /* This is not Posix, and is not defined on some Posix systems. */
       return (FALSE);
 #else
-      return (sh_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISVTX) != 0);
+      return (test_stat (arg, &stat_buf) == 0 && (stat_buf.st_mode & S_ISVTX) != 0);
 #endif
 
     case 't':	/* File fd is a terminal? */
@@ -866,6 +976,218 @@ posixtest ()
   return (value);
 }
 
+/* Return non-zero if W, an unexpanded argument to test, always expands to
+   exactly one argument: either a literal containing nothing that brace
+   expansion, pathname expansion, or quote removal acts on, or a single- or
+   double-quoted string that can't expand to more or fewer than one word. */
+static int
+test_word_onefield (w)
+     WORD_DESC *w;
+{
+  char *s, *e;
+
+  s = w->word;
+  if (*s == '\0')
+    return 0;
+  e = s + strlen (s) - 1;
+  if ((s[0] == '\'' || s[0] == '"') && e > s && *e == s[0])
+    {
+      for (s++; s < e; s++)
+	if (*s == *e || *s == '\\' || (*e == '"' && (*s == '@' || *s == '`')))
+	  return 0;
+      return 1;
+    }
+
+  return (strpbrk (s, "*?[]{}()\\$`'\"") == 0);
+}
+
+/* Return non-zero if W is the unquoted word S. */
+static int
+test_word_literal (w, s)
+     WORD_DESC *w;
+     char *s;
+{
+  return ((w->flags & (W_HASDOLLAR|W_QUOTED)) == 0 && STREQ (w->word, s));
+}
+
+/* If W is a literal that could be one of test's operators, return its text
+   after quote removal in newly-allocated memory. */
+static char *
+test_word_operator (w)
+     WORD_DESC *w;
+{
+  char *t;
+
+  if ((w->flags & W_HASDOLLAR) || test_word_onefield (w) == 0)
+    return ((char *)NULL);
+  t = (w->flags & W_QUOTED) ? string_quote_removal (w->word, 0) : savestring (w->word);
+  if (t[0] == '\0' || (t[1] && t[2] && t[3]))
+    {
+      free (t);
+      return ((char *)NULL);
+    }
+  return t;
+}
+
+/* Fill in the operator class of TC for T, one of test's binary operators.
+   Return 0 if T isn't one. */
+static int
+test_compile_binop (tc, t)
+     TEST_COMPILED *tc;
+     char *t;
+{
+  if (test_binop (t) == 0)
+    return 0;
+
+  tc->type = TC_BINARY;
+  tc->op = TC_STRING;
+  if (t[0] == '=' && (t[1] == '\0' || t[1] == '='))
+    tc->subop = EQ;
+  else if (t[0] == '!' && t[1] == '=')
+    tc->subop = NE;
+  else if (t[0] == '<' || t[0] == '>')
+    tc->subop = (t[0] == '<') ? LT : GT;
+  else if (t[1] == '~')
+    {
+      tc->op = TC_PATTERN;
+      tc->subop = (t[0] == '=') ? EQ : NE;
+    }
+  else if (t[2] == 't')
+    {
+      tc->op = (t[1] == 'n' || t[1] == 'o') ? TC_FILE : TC_ARITH;
+      switch (t[1])
+	{
+	case 'n': tc->subop = NT; break;	/* -nt */
+	case 'o': tc->subop = OT; break;	/* -ot */
+	case 'l': tc->subop = LT; break;	/* -lt */
+	case 'g': tc->subop = GT; break;	/* -gt */
+	}
+    }
+  else if (t[1] == 'e')
+    {
+      tc->op = (t[2] == 'f') ? TC_FILE : TC_ARITH;
+      tc->subop = (t[2] == 'f') ? EF : EQ;	/* -ef, -eq */
+    }
+  else
+    {
+      tc->op = TC_ARITH;
+      switch (t[1])
+	{
+	case 'n': tc->subop = NE; break;	/* -ne */
+	case 'g': tc->subop = GE; break;	/* -ge */
+	case 'l': tc->subop = LE; break;	/* -le */
+	}
+    }
+
+  strcpy (tc->opname, t);
+  return 1;
+}
+
+/* Precompile the arguments WORDS to test, or to [ if BRACKET is non-zero,
+   before they're expanded.  If every argument expands to exactly one word,
+   the number of arguments is known, and if the argument in the position
+   POSIX's rules for that number check for an operator is a literal operator,
+   the way the expression is evaluated is fixed.  These are the forms
+
+	op arg			(two arguments, unary operator)
+	arg op arg		(three arguments, binary operator)
+	! op arg		(three arguments, unary operator)
+	! arg op arg		(four arguments, binary operator)
+
+   Returns a newly-allocated TEST_COMPILED, or NULL if WORDS doesn't have
+   one of these forms. */
+TEST_COMPILED *
+test_compile (words, bracket)
+     WORD_LIST *words;
+     int bracket;
+{
+  WORD_LIST *w;
+  WORD_DESC *args[5];
+  TEST_COMPILED tc, *ret;
+  char *t;
+  int n;
+
+  for (n = 0, w = words; w && (bracket == 0 || w->next); w = w->next)
+    {
+      if (n == 4 || test_word_onefield (w->word) == 0)
+	return ((TEST_COMPILED *)NULL);
+      args[++n] = w->word;
+    }
+  if (bracket && (w == 0 || test_word_literal (w->word, "]") == 0))
+    return ((TEST_COMPILED *)NULL);
+  if (n < 2)
+    return ((TEST_COMPILED *)NULL);
+
+  tc.type = 0;
+  tc.nargs = n;
+  tc.negate = (n == 4 || n == 3) && test_word_literal (args[1], "!");
+  tc.opind = (n == 2) ? 1 : n - 1;
+
+  if (n == 4 && tc.negate == 0)
+    return ((TEST_COMPILED *)NULL);
+
+  t = test_word_operator (args[tc.opind]);
+  if (t == 0)
+    return ((TEST_COMPILED *)NULL);
+
+  if (n > 2 && test_compile_binop (&tc, t))
+    {
+      /* `! arg op arg' is the only four-argument form; with three arguments
+	 a binary operator in the middle is used even if the first is `!'. */
+      if (n == 3)
+	tc.negate = 0;
+    }
+  else if ((n == 2 || (n == 3 && tc.negate)) && test_unop (t) &&
+	   (n == 2 || ANDOR (t) == 0) && t[1] != 't')
+    {
+      /* With three arguments, `-a' and `-o' are binary operators that
+	 don't have a fixed meaning.  `-t' may or may not take an argument. */
+      tc.type = TC_UNARY;
+      tc.op = TC_FILETEST;
+      tc.subop = 0;
+      strcpy (tc.opname, t);
+    }
+
+  free (t);
+  if (tc.type == 0)
+    return ((TEST_COMPILED *)NULL);
+
+  ret = (TEST_COMPILED *)xmalloc (sizeof (TEST_COMPILED));
+  *ret = tc;
+  return ret;
+}
+
+/* Evaluate the precompiled expression TC using the arguments in ARGV. */
+static int
+test_compiled_eval (tc)
+     TEST_COMPILED *tc;
+{
+  char *arg1, *arg2;
+
+  if (tc->type == TC_UNARY)
+    return (unary_test (tc->opname, argv[tc->opind + 1], 0));
+
+  arg1 = argv[tc->opind - 1];
+  arg2 = argv[tc->opind + 1];
+  switch (tc->op)
+    {
+    case TC_STRING:
+      switch (tc->subop)
+	{
+	case EQ: return (STREQ (arg1, arg2));
+	case NE: return (STREQ (arg1, arg2) == 0);
+	case LT: return (strcmp (arg1, arg2) < 0);
+	case GT: return (strcmp (arg1, arg2) > 0);
+	}
+      break;
+    case TC_PATTERN: return (patcomp (arg1, arg2, tc->subop));
+    case TC_ARITH: return (arithcomp (arg1, arg2, tc->subop, 0));
+    case TC_FILE: return (filecomp (arg1, arg2, tc->subop));
+    }
+
+  return (FALSE);
+}
+
 /*
  * [:
  *	'[' expr ']'
@@ -879,13 +1201,22 @@ test_command (margc, margv)
 {
   int value;
   int code;
+  TEST_COMPILED tc;
 
   USE_VAR(margc);
 
+  tc = test_compiled;
+  test_compiled.type = 0;
+
   code = setjmp_nosigs (test_exit_buf);
 
   if (code)
-    return (test_error_return);
+    {
+      test_statcache_end ();
+      return (test_error_return);
+    }
+
+  test_statcache_begin ();
 
   argv = margv;
 
@@ -907,6 +1238,17 @@ test_command (margc, margv)
     test_exit (SHELL_BOOLEAN (FALSE));
 
   noeval = 0;
+
+  /* The expanded arguments have to match the precompiled form exactly;
+     the same number of them and the same operator in the same place
+     determine the same evaluation. */
+  if (tc.type && argc - 1 == tc.nargs && STREQ (argv[tc.opind], tc.opname) &&
+      (tc.negate == 0 || (argv[1][0] == '!' && argv[1][1] == '\0')))
+    {
+      value = test_compiled_eval (&tc);
+      test_exit (SHELL_BOOLEAN (tc.negate ? !value : value));
+    }
+
   value = posixtest ();
 
   if (pos != argc)
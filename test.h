@@ -35,6 +35,37 @@ extern int test_binop PARAMS((char *));
 extern int unary_test PARAMS((char *, char *, int));
 extern int binary_test PARAMS((char *, char *, char *, int));
 
+/* A test or [ command whose argument count is fixed before expansion and
+   whose operator is a literal, so the POSIX rules for that number of
+   arguments determine how it's evaluated.  Made by test_compile. */
+typedef struct test_compiled {
+  int type;		/* TC_UNARY or TC_BINARY */
+  int nargs;		/* number of arguments, not counting a closing `]' */
+  int negate;		/* non-zero if the expression is preceded by `!' */
+  int opind;		/* index of the operator in the argument list */
+  int op;		/* operator class, one of the TC_ values below */
+  int subop;		/* operation within the class */
+  char opname[4];	/* operator text, checked against the argument */
+} TEST_COMPILED;
+
+/* Values for type */
+#define TC_UNARY	1
+#define TC_BINARY	2
+
+/* Values for op */
+#define TC_STRING	1	/* =, ==, !=, <, > */
+#define TC_PATTERN	2	/* =~, !~ */
+#define TC_ARITH	3	/* -eq, -ne, -lt, -gt, -le, -ge */
+#define TC_FILE		4	/* -nt, -ot, -ef */
+#define TC_FILETEST	5	/* unary operators */
+
+extern TEST_COMPILED test_compiled;
+
 extern int test_command PARAMS((int, char **));
+extern TEST_COMPILED *test_compile PARAMS((WORD_LIST *, int));
+
+extern int test_statcache;
+extern void test_statcache_begin PARAMS((void));
+extern void test_statcache_end PARAMS((void));
 
 #endif /* _TEST_H_ */
@@ -85,6 +85,9 @@
 #define FUNCTIONS_HASH_BUCKETS	512
 #define TEMPENV_HASH_BUCKETS	4	/* must be power of two */
 
+#define VARCACHESIZE		128	/* cached SHELL_VAR structs */
+#define TABLECACHESIZE		32	/* cached empty TEMPENV-sized tables */
+
 #define BASHFUNC_PREFIX		"BASH_FUNC_"
 #define BASHFUNC_PREFLEN	10	/* == strlen(BASHFUNC_PREFIX */
 #define BASHFUNC_SUFFIX		"%%"
@@ -166,6 +169,16 @@ pid_t dollar_dollar_pid;
 /* Non-zero means that we have to remake EXPORT_ENV. */
 int array_needs_making = 1;
 
+/* Each temporary environment gets a new generation number when it's created.
+   EXPORT_ENV_TEMPENV is the generation of the temporary environment whose
+   variables are in EXPORT_ENV, or 0 if none are.  Keeping track of this
+   lets us add the temporary environment to an up-to-date EXPORT_ENV
+   instead of remaking the whole thing, and in the parent shell to leave it
+   out entirely, so running `var=value command' doesn't force EXPORT_ENV to
+   be remade twice. */
+static int tempenv_generation = 0;
+static int export_env_tempenv = 0;
+
 /* The number of times BASH has been executed.  This is set
    by initialize_variables (). */
 int shell_level = 0;
@@ -187,6 +200,14 @@ static SHELL_VAR nameref_maxloop_value;
 static HASH_TABLE *last_table_searched;	/* hash_lookup sets this */
 static VAR_CONTEXT *last_context_searched;
 
+/* Object caching.  Function calls, local variables, and temporary
+   environments create and destroy SHELL_VARs and small hash tables at a
+   high rate; keep a supply of recently-freed ones around. */
+static sh_obj_cache_t varcache = {0, 0, 0};
+
+static HASH_TABLE *tablecache[TABLECACHESIZE];
+static int ntablecache;
+
 /* Some forward declarations. */
 static void create_variable_tables PARAMS((void));
 
@@ -322,10 +343,15 @@ static char **make_env_array_from_var_list PARAMS((SHELL_VAR **));
 static char **make_var_export_array PARAMS((VAR_CONTEXT *));
 static char **make_func_export_array PARAMS((void));
 static void add_temp_array_to_env PARAMS((char **, int, int));
+static void add_tempenv_to_export_env PARAMS((void));
+static void make_export_env PARAMS((int));
 
 static int n_shell_variables PARAMS((void));
 static int set_context PARAMS((SHELL_VAR *));
 
+static HASH_TABLE *new_tempenv_table PARAMS((void));
+static void dispose_tempenv_table PARAMS((HASH_TABLE *));
+
 static void push_func_var PARAMS((PTR_T));
 static void push_builtin_var PARAMS((PTR_T));
 static void push_exported_var PARAMS((PTR_T));
@@ -345,6 +371,7 @@ create_variable_tables ()
       shell_variables = global_variables = new_var_context ((char *)NULL, 0);
       shell_variables->scope = 0;
       shell_variables->table = hash_create (VARIABLES_HASH_BUCKETS);
+      ocache_create (varcache, SHELL_VAR, VARCACHESIZE);
     }
 
   if (shell_functions == 0)
@@ -2672,7 +2699,7 @@ make_local_variable (name, flags)
       return ((SHELL_VAR *)NULL);
     }
   else if (vc->table == 0)
-    vc->table = hash_create (TEMPENV_HASH_BUCKETS);
+    vc->table = new_tempenv_table ();
 
   /* Since this is called only from the local/declare/typeset code, we can
      call builtin_error here without worry (of course, it will also work
@@ -2765,7 +2792,7 @@ new_shell_variable (name)
 {
   SHELL_VAR *entry;
 
-  entry = (SHELL_VAR *)xmalloc (sizeof (SHELL_VAR));
+  ocache_alloc (varcache, SHELL_VAR, entry);
 
   entry->name = savestring (name);
   var_setvalue (entry, (char *)NULL);
@@ -3414,6 +3441,35 @@ bind_variable_value (var, value, aflags)
   return (var);
 }
 
+/* Make VALUE, which the caller has allocated, the value of the existing
+   string variable VAR without copying it or looking VAR up again, if
+   nothing about VAR or the current temporary environment requires
+   bind_variable's more general handling.  VAR must be the variable a call
+   to bind_variable with VAR's name would assign.  Returns VAR if VALUE was
+   installed; otherwise returns NULL and the caller still owns VALUE. */
+SHELL_VAR *
+bind_variable_direct (var, value)
+     SHELL_VAR *var;
+     char *value;
+{
+  if (var == 0 || temporary_env || var->assign_func ||
+	(var->attributes & (att_readonly|att_noassign|att_array|att_assoc|att_integer|att_uppercase|att_lowercase|att_capcase|att_nameref|att_nofree)))
+    return ((SHELL_VAR *)NULL);
+
+  VUNSETATTR (var, att_invisible);
+  INVALIDATE_EXPORTSTR (var);
+  FREE (value_cell (var));
+  var_setvalue (var, value);
+
+  if (mark_modified_vars)
+    VSETATTR (var, att_exported);
+
+  if (exported_p (var))
+    array_needs_making = 1;
+
+  return (var);
+}
+
 /* Bind/create a shell variable with the name LHS to the RHS.
    This creates or modifies a variable such that it is an integer.
 
@@ -3519,6 +3575,7 @@ bind_function (name, value)
       elt = hash_insert (savestring (name), shell_functions, HASH_NOSRCH);
       entry = new_shell_variable (name);
       elt->data = (PTR_T)entry;
+      INVALIDATE_COMMAND_LOOKUPS ();
     }
   else
     INVALIDATE_EXPORTSTR (entry);
@@ -3669,7 +3726,11 @@ assign_in_env (word, flags)
     }
 
   if (temporary_env == 0)
-    temporary_env = hash_create (TEMPENV_HASH_BUCKETS);
+    {
+      temporary_env = new_tempenv_table ();
+      if (++tempenv_generation <= 0)
+	tempenv_generation = 1;
+    }
 
   var = hash_lookup (newname, temporary_env);
   if (var == 0)
@@ -3690,7 +3751,10 @@ assign_in_env (word, flags)
   INVALIDATE_EXPORTSTR (var);
   var->exportstr = mk_env_string (newname, value, 0);
 
-  array_needs_making = 1;
+  /* maybe_make_export_env will add this to the export env if it's needed;
+     we only have to remake it if this temporary env is already there. */
+  if (export_env_tempenv == tempenv_generation)
+    array_needs_making = 1;
 
   if (flags)
     {
@@ -3724,7 +3788,7 @@ copy_variable (var)
 
   if (var)
     {
-      copy = (SHELL_VAR *)xmalloc (sizeof (SHELL_VAR));
+      ocache_alloc (varcache, SHELL_VAR, copy);
 
       copy->attributes = var->attributes;
       copy->name = savestring (var->name);
@@ -3797,7 +3861,7 @@ dispose_variable (var)
   if (exported_p (var))
     array_needs_making = 1;
 
-  free (var);
+  ocache_free (varcache, SHELL_VAR, var);
 }
 
 /* Unset the shell variable referenced by NAME.  Unsetting a nameref variable
@@ -3907,6 +3971,8 @@ unbind_func (name)
   set_itemlist_dirty (&it_functions);
 #endif
 
+  INVALIDATE_COMMAND_LOOKUPS ();
+
   func = (SHELL_VAR *)elt->data;
   if (func)
     {
@@ -4064,7 +4130,7 @@ kill_all_local_variables ()
   if (vc->table && vc_haslocals (vc))
     {
       delete_all_variables (vc->table);
-      hash_dispose (vc->table);
+      dispose_tempenv_table (vc->table);
     }
   vc->table = (HASH_TABLE *)NULL;
 }
@@ -4527,6 +4593,8 @@ bind_tempenv_variable (name, value)
       FREE (value_cell (var));
       var_setvalue (var, savestring (value));
       INVALIDATE_EXPORTSTR (var);
+      if (export_env_tempenv == tempenv_generation)
+	array_needs_making = 1;
     }
 
   return (var);
@@ -4578,6 +4646,8 @@ push_posix_temp_var (data)
   if (v)
     {
       v->attributes |= var->attributes;		/* preserve tempvar attribute if appropriate */
+      if (exported_p (v))
+	array_needs_making = 1;
       /* If we don't bind a local variable, propagate the value. If we bind a
 	 local variable (the "current execution environment"), keep it as local
 	 and don't propagate it to the calling environment. */
@@ -4619,7 +4689,7 @@ push_temp_var (data)
 	/* shouldn't happen */
 	binding_table = shell_variables->table = global_variables->table = hash_create (VARIABLES_HASH_BUCKETS);
       else
-	binding_table = shell_variables->table = hash_create (TEMPENV_HASH_BUCKETS);
+	binding_table = shell_variables->table = new_tempenv_table ();
     }
 
   v = bind_variable_internal (var->name, value_cell (var), binding_table, 0, ASS_FORCE|ASS_NOLONGJMP);
@@ -4638,7 +4708,11 @@ push_temp_var (data)
 	shell_variables->flags |= VC_HASTMPVAR;
     }
   if (v)
-    v->attributes |= var->attributes;
+    {
+      v->attributes |= var->attributes;
+      if (exported_p (v))
+	array_needs_making = 1;
+    }
 
   if (find_special_var (var->name) >= 0)
     tempvar_list[tvlist_ind++] = savestring (var->name);
@@ -4688,11 +4762,14 @@ dispose_temporary_env (pushf)
   temporary_env = (HASH_TABLE *)NULL;
 
   hash_flush (disposer, pushf);
-  hash_dispose (disposer);
+  dispose_tempenv_table (disposer);
 
   tempvar_list[tvlist_ind] = 0;
 
-  array_needs_making = 1;
+  /* Variables pushed into the current scope mark the export env as needing
+     to be remade; otherwise only remake it if these variables were added. */
+  if (export_env_tempenv)
+    array_needs_making = 1;
 
   for (i = 0; i < tvlist_ind; i++)
     stupidly_hack_special_variables (tempvar_list[i]);
@@ -4739,7 +4816,7 @@ flush_temporary_env ()
   if (temporary_env)
     {
       hash_flush (temporary_env, free_variable_hash_data);
-      hash_dispose (temporary_env);
+      dispose_tempenv_table (temporary_env);
       temporary_env = (HASH_TABLE *)NULL;
     }
 }
@@ -5105,8 +5182,57 @@ chkexport (name)
   return 0;
 }
 
+/* Add the variables in the temporary environment to an otherwise up-to-date
+   export_env, superseding any existing variables with the same names. */
+static void
+add_tempenv_to_export_env ()
+{
+  VAR_CONTEXT *tcxt;
+  char **temp_array;
+
+  tcxt = new_var_context ((char *)NULL, 0);
+  tcxt->table = temporary_env;
+  temp_array = make_var_export_array (tcxt);
+  free (tcxt);
+
+  if (temp_array)
+    add_temp_array_to_env (temp_array, 0, 1);
+  export_env_tempenv = tempenv_generation;
+}
+
 void
 maybe_make_export_env ()
+{
+  /* Variables from a temporary environment that's gone or been replaced
+     have to be removed. */
+  if (export_env_tempenv && (temporary_env == 0 || export_env_tempenv != tempenv_generation))
+    array_needs_making = 1;
+
+  if (array_needs_making)
+    make_export_env (1);
+  else if (temporary_env && HASH_ENTRIES (temporary_env) && export_env_tempenv != tempenv_generation)
+    add_tempenv_to_export_env ();
+}
+
+/* Make sure export_env is up to date, but leave the temporary environment
+   out of it.  The shell calls this before forking a child to execute a
+   command preceded by assignment statements; the child adds them to its
+   own copy, and the parent's export_env doesn't have to be remade after the
+   command finishes. */
+void
+maybe_make_base_export_env ()
+{
+  if (export_env_tempenv)
+    array_needs_making = 1;
+  make_export_env (0);
+}
+
+/* Remake export_env from all of the exported shell variables and functions
+   if it needs it.  If WITH_TEMPENV is non-zero, include the variables in the
+   temporary environment. */
+static void
+make_export_env (with_tempenv)
+     int with_tempenv;
 {
   register char **temp_array;
   int new_size;
@@ -5135,7 +5261,7 @@ maybe_make_export_env ()
 	 the front of shell_variables, call make_var_export_array on the
 	 whole thing to flatten it, and convert the list of SHELL_VAR *s
 	 to the form needed by the environment. */
-      if (temporary_env)
+      if (with_tempenv && temporary_env)
 	{
 	  tcxt = new_var_context ((char *)NULL, 0);
 	  tcxt->table = temporary_env;
@@ -5173,6 +5299,8 @@ maybe_make_export_env ()
 	add_temp_array_to_env (temp_array, 0, 0);
 
       array_needs_making = 0;
+      export_env_tempenv = (with_tempenv && temporary_env && HASH_ENTRIES (temporary_env))
+				? tempenv_generation : 0;
     }
 }
 
@@ -5246,12 +5374,36 @@ dispose_var_context (vc)
   if (vc->table)
     {
       delete_all_variables (vc->table);
-      hash_dispose (vc->table);
+      dispose_tempenv_table (vc->table);
     }
 
   free (vc);
 }
 
+/* Return an empty hash table suitable for a function's local variables or
+   a temporary environment, reusing one from the cache if possible. */
+static HASH_TABLE *
+new_tempenv_table ()
+{
+  if (ntablecache > 0)
+    return (tablecache[--ntablecache]);
+  return (hash_create (TEMPENV_HASH_BUCKETS));
+}
+
+/* Dispose of TABLE, which the caller has already emptied.  Tables that
+   still have their original size go back into the cache; tables that
+   have grown are freed. */
+static void
+dispose_tempenv_table (table)
+     HASH_TABLE *table;
+{
+  if (table->nbuckets == TEMPENV_HASH_BUCKETS && HASH_ENTRIES (table) == 0 &&
+      ntablecache < TABLECACHESIZE)
+    tablecache[ntablecache++] = table;
+  else
+    hash_dispose (table);
+}
+
 /* Set VAR's scope level to the current variable context. */
 static int
 set_context (var)
@@ -5291,6 +5443,9 @@ push_var_context (name, flags, tempvars)
       /* XXX - only need to do it if flags&VC_FUNCENV */
       flatten (tempvars, set_context, (VARLIST *)NULL, 0);
       vc->flags |= VC_HASTMPVAR;
+      /* The variables are now exported from this context */
+      if (HASH_ENTRIES (tempvars))
+	array_needs_making = 1;
     }
   vc->down = shell_variables;
   shell_variables->up = vc;
@@ -5542,7 +5697,7 @@ pop_scope (is_special)
 	hash_flush (vcxt->table, push_builtin_var);
       else
 	hash_flush (vcxt->table, push_exported_var);
-      hash_dispose (vcxt->table);
+      dispose_tempenv_table (vcxt->table);
     }
   free (vcxt);
 
@@ -5623,6 +5778,7 @@ clear_dollar_vars ()
 
   rest_of_args = (WORD_LIST *)NULL;
   posparam_count = 0;
+  invalidate_posparam_index ();
 }
 
 /* XXX - should always be followed by remember_args () */
@@ -5666,6 +5822,7 @@ push_dollar_vars ()
   dollar_arg_stack[dollar_arg_stack_index++].rest = rest_of_args;
   rest_of_args = (WORD_LIST *)NULL;
   posparam_count = 0;
+  invalidate_posparam_index ();
   
   dollar_arg_stack[dollar_arg_stack_index].first_ten = (char **)NULL;
   dollar_arg_stack[dollar_arg_stack_index].rest = (WORD_LIST *)NULL;  
@@ -5682,6 +5839,7 @@ pop_dollar_vars ()
   clear_dollar_vars ();
 
   rest_of_args = dollar_arg_stack[--dollar_arg_stack_index].rest;
+  invalidate_posparam_index ();
   restore_dollar_vars (dollar_arg_stack[dollar_arg_stack_index].first_ten);
   free (dollar_arg_stack[dollar_arg_stack_index].first_ten);
   posparam_count = dollar_arg_stack[dollar_arg_stack_index].count;
@@ -6472,6 +6630,90 @@ restore_pipestatus_array (a)
 
   array_dispose (a2);
 }
+
+/* Like save_pipestatus_array, but store the values of PIPESTATUS into VALS
+   instead of copying the array, as long as it's what the shell itself sets:
+   no more than MAX small non-negative integers at indices 0..n-1.  Returns
+   the number of values saved, or -1 if the caller should fall back to
+   save_pipestatus_array(). */
+int
+save_pipestatus_values (vals, max)
+     int *vals;
+     int max;
+{
+  SHELL_VAR *v;
+  ARRAY *a;
+  arrayind_t i, n;
+  char *s;
+  int r;
+
+  v = find_variable ("PIPESTATUS");
+  if (v == 0 || array_p (v) == 0 || array_cell (v) == 0)
+    return -1;
+
+  a = array_cell (v);
+  n = array_num_elements (a);
+  if (n == 0 || n > max || array_max_index (a) != n - 1)
+    return -1;
+
+  for (i = 0; i < n; i++)
+    {
+      s = array_reference (a, i);
+      /* Only canonical decimal strings, so restore can compare values */
+      if (s == 0 || DIGIT (*s) == 0 || (s[0] == '0' && s[1]) || strlen (s) > 9)
+	return -1;
+      for (r = 0; *s; s++)
+	{
+	  if (DIGIT (*s) == 0)
+	    return -1;
+	  r = r * 10 + TODIGIT (*s);
+	}
+      vals[i] = r;
+    }
+  return n;
+}
+
+/* Restore PIPESTATUS from N values saved by save_pipestatus_values().  The
+   array is left alone if it hasn't changed, which is the usual case when
+   all that happened in between was parsing. */
+void
+restore_pipestatus_values (vals, n)
+     int *vals;
+     int n;
+{
+  SHELL_VAR *v;
+  ARRAY *a, *a2;
+  arrayind_t i;
+  char *s, *t, tbuf[INT_STRLEN_BOUND(int) + 1];
+
+  v = find_variable ("PIPESTATUS");
+  if (v == 0 || array_p (v) == 0 || array_cell (v) == 0)
+    return;
+
+  a = array_cell (v);
+  if (array_num_elements (a) == n && array_max_index (a) == n - 1)
+    {
+      for (i = 0; i < n; i++)
+	{
+	  s = array_reference (a, i);
+	  t = inttostr (vals[i], tbuf, sizeof (tbuf));
+	  if (s == 0 || STREQ (s, t) == 0)
+	    break;
+	}
+      if (i == n)
+	return;
+    }
+
+  /* Replace the array wholesale, the way restore_pipestatus_array does */
+  a2 = array_create ();
+  for (i = 0; i < n; i++)
+    {
+      t = inttostr (vals[i], tbuf, sizeof (tbuf));
+      array_insert (a2, i, t);
+    }
+  var_setarray (v, a2);
+  array_dispose (a);
+}
 #endif
 
 void
@@ -319,6 +319,7 @@ extern char *sh_get_env_value PARAMS((const char *));
 extern char *make_variable_value PARAMS((SHELL_VAR *, char *, int));
 
 extern SHELL_VAR *bind_variable_value PARAMS((SHELL_VAR *, char *, int));
+extern SHELL_VAR *bind_variable_direct PARAMS((SHELL_VAR *, char *));
 extern SHELL_VAR *bind_int_variable PARAMS((char *, char *, int));
 extern SHELL_VAR *bind_var_to_int PARAMS((char *, intmax_t, int));
 
@@ -380,6 +381,7 @@ extern void sort_variables PARAMS((SHELL_VAR **));
 
 extern int chkexport PARAMS((char *));
 extern void maybe_make_export_env PARAMS((void));
+extern void maybe_make_base_export_env PARAMS((void));
 extern void update_export_env_inplace PARAMS((char *, int, char *));
 extern void put_command_name_into_env PARAMS((char *));
 extern void put_gnu_argv_flags_into_env PARAMS((intmax_t, char *));
@@ -400,6 +402,8 @@ extern SHELL_VAR *make_local_assoc_variable PARAMS((char *, int));
 extern void set_pipestatus_array PARAMS((int *, int));
 extern ARRAY *save_pipestatus_array PARAMS((void));
 extern void restore_pipestatus_array PARAMS((ARRAY *));
+extern int save_pipestatus_values PARAMS((int *, int));
+extern void restore_pipestatus_values PARAMS((int *, int));
 #endif
 
 extern void set_pipestatus_from_exit PARAMS((int));